@@ -24,6 +24,7 @@
 #include "mm.h"
 #include "memlib.h"
 #include "fcyc.h"
+#include "clock.h"
 #include "config.h"
 #include "stree.h"
 
@@ -40,6 +41,18 @@
 #define REF_ONLY 0
 #endif
 
+/* Number of replays used to measure per-operation latency (lowest wins) */
+#define LATENCY_RUNS   3
+
+/* Largest batch passed to mm_malloc_batch or mm_free_batch with -B */
+#define BATCH_MAX     64
+
+/* -g tags a block that lives fewer ops than these lifetime class 1, 2 or 3;
+   blocks that live longer, or are never freed, are left untagged */
+#define HINT_SHORT    16
+#define HINT_MEDIUM   64
+#define HINT_LONG     256
+
 /* Returns true if p is ALIGNMENT-byte aligned */
 #define IS_ALIGNED(p)  ((((unsigned long)(p)) % ALIGNMENT) == 0)
 
@@ -80,9 +93,16 @@ typedef struct {
 
 /* Characterizes a single trace operation (allocator request) */
 typedef struct {
-    enum { ALLOC, FREE, REALLOC } type; /* type of request */
+    enum { ALLOC, FREE, REALLOC, CALLOC, MEMALIGN, ARENA } type; /* type of request */
     long index;                         /* index for free() to use later */
-    size_t size;                        /* byte size of alloc/realloc request */
+    size_t size;                        /* byte size of alloc/realloc request,
+                                           or of the block a free releases */
+    size_t align;                       /* alignment of memalign request */
+    size_t old_size;                    /* size of the block a realloc resizes */
+    long batch;                         /* ops in the run of mallocs of this size,
+                                           or of frees, starting here */
+    int lifetime;                       /* lifetime class for mm_malloc_hint,
+                                           0 if the malloc has no hint */
 } traceop_t;
 
 /* Holds the information for one trace file */
@@ -96,6 +116,13 @@ typedef struct {
     char **blocks;        /* array of ptrs returned by malloc/realloc... */
     size_t *block_sizes;  /* ... and a corresponding array of payload sizes */
     int *block_rand_base; /* index into random_data, if debug is on */
+    int *block_arena;     /* arena each id is allocated from, or -1 */
+    int num_arenas;       /* number of arenas declared by the trace */
+    mm_arena_t **arenas;  /* the arenas, created by their ARENA ops */
+    size_t *arena_live;   /* number of blocks live in each arena */
+    int *arena_last_op;   /* last request for a block of each arena */
+    mm_arena_t **spare_arenas; /* reset arenas done with their ids */
+    int num_spare;        /* number of spare arenas */
 } trace_t;
 
 /*
@@ -123,6 +150,24 @@ typedef struct {
     /* defined only for the student malloc package */
     double util;       /* space utilization for this trace (always 0 for libc) */
 
+    /* per-operation latency percentiles in nsecs, only set with -L */
+    double lat_p50;
+    double lat_p99;
+    double lat_p999;
+    double lat_max;
+
+    /* realloc copy traffic in bytes during the util run, only printed with -R */
+    double realloc_ops;   /* number of realloc requests */
+    double realloc_fits;  /* ... whose new size fit in mm_usable_size of the block */
+    double copy_naive;    /* bytes a malloc/copy/free realloc would move */
+    double copy_bytes;    /* bytes actually moved by mem_memcpy */
+
+    /* heap size, counting mapped regions, during the util run; printed with -H */
+    double sbrk_calls;    /* number of successful mem_sbrk calls */
+    double heap_bytes;    /* heap size at the end of the run */
+    double heap_avg;      /* heap size averaged over all requests */
+    double heap_peak;     /* largest heap size during the run */
+
     /* Note: secs and util are only defined if valid is true */
 } stats_t;
 
@@ -161,6 +206,17 @@ int verbose = REF_ONLY ? 0 : 1;  /* global flag for verbose output */
 static int errors = 0;           /* number of errs found when running student malloc */
 static bool onetime_flag = false;
 static bool tab_mode = false;     /* Print output as tab-separated fields */
+static bool latency_mode = false; /* Measure per-operation latency percentiles */
+static bool realloc_mode = false; /* Report realloc copy traffic */
+static bool heap_mode = false;    /* Report heap size */
+static bool sized_mode = false;   /* Free with mm_free_sized */
+static bool batch_mode = false;   /* Group runs of like ops into batches */
+static bool hint_mode = false;    /* Pass the lifetime hints of mallocs */
+static bool auto_hint = false;    /* Derive hints from when blocks die */
+static void *batch_blocks[BATCH_MAX]; /* Blocks of the current batch */
+static long batch_next = 0;       /* Next block of a malloc batch to hand out */
+static long batch_count = 0;      /* Blocks in the current malloc batch */
+static long batch_freed = 0;      /* Later frees of the run already done */
 /* If set, use sparse memory emulation */
 static bool sparse_mode = SPARSE_MODE;
 static size_t maxfill = SPARSE_MODE ? MAXFILL_SPARSE : MAXFILL;
@@ -212,6 +268,7 @@ static void free_range_set(range_set_t *ranges);
 /* These functions implement the debugging code */
 static void init_random_data(void);
 static bool check_index(const trace_t *trace, int opnum, int index);
+static bool check_zero(const trace_t *trace, int opnum, int index);
 static void randomize_block(trace_t *trace, int index);
 
 /* These functions read, allocate, and free storage for traces */
@@ -227,11 +284,27 @@ static void eval_libc_speed(void *ptr);
 /* Routines for evaluating correctnes, space utilization, and speed
    of the student's malloc package in mm.c */
 static bool eval_mm_valid(trace_t *trace, range_set_t *ranges);
-static double eval_mm_util(trace_t *trace, int tracenum);
+static double eval_mm_util(trace_t *trace, int tracenum, stats_t *stats);
 static void eval_mm_speed(void *ptr);
+static void eval_mm_latency(trace_t *trace, stats_t *stats);
+
+/* Batches of mallocs and frees for -B */
+static long batch_length(const trace_t *trace, int opnum);
+static char *batch_malloc(const trace_t *trace, int opnum);
+static void batch_free(const trace_t *trace, int opnum);
+
+/* Arenas declared by the trace */
+static bool arena_owned(const trace_t *trace, long index);
+static bool arena_start(trace_t *trace, int opnum);
+static char *arena_alloc(trace_t *trace, int opnum);
+static void arena_free(trace_t *trace, int opnum);
+static bool arena_op(trace_t *trace, int opnum);
 
 /* Various helper routines */
 static void printresults(int n, stats_t *stats, sum_stats_t *sumstats);
+static void printlatency(int n, stats_t *stats);
+static void printrealloc(int n, stats_t *stats);
+static void printheap(int n, stats_t *stats);
 static void usage(char *prog);
 static void malloc_error(const trace_t *trace, int opnum, const char *fmt, ...)
     __attribute__((format(printf, 3,4)));
@@ -295,13 +368,15 @@ static void run_tests(int num_tracefiles, const char *tracedir,
         if (mm_stats[i].valid) {
             if (verbose > 1)
                 printf("efficiency, ");
-            mm_stats[i].util = eval_mm_util(trace, i);
+            mm_stats[i].util = eval_mm_util(trace, i, &mm_stats[i]);
             speed_params->trace = trace;
             speed_params->ranges = ranges;
             if (verbose > 1)
                 printf("and performance.\n");
             mm_stats[i].secs = sparse_mode ? 1.0 : fsec(eval_mm_speed, speed_params);
             mm_stats[i].tput = mm_stats[i].ops / (mm_stats[i].secs * 1000.0);
+            if (latency_mode && !sparse_mode)
+                eval_mm_latency(trace, &mm_stats[i]);
         }
 
 #if 0
@@ -347,7 +422,7 @@ int main(int argc, char **argv)
     /*
      * Read and interpret the command line arguments
      */
-    while ((c = getopt(argc, argv, "d:f:c:s:t:v:hpOVAlDT")) != EOF) {
+    while ((c = getopt(argc, argv, "d:f:c:s:t:v:hpOVAlDTLRHSBGg")) != EOF) {
         switch (c) {
 
         case 'A': /* Hidden Autolab driver argument */
@@ -404,6 +479,32 @@ int main(int argc, char **argv)
             tab_mode = true;
             break;
 
+        case 'L': /* Report per-operation latency percentiles */
+            latency_mode = true;
+            break;
+
+        case 'R': /* Report realloc copy traffic */
+            realloc_mode = true;
+            break;
+
+        case 'H': /* Report heap size */
+            heap_mode = true;
+            break;
+
+        case 'S': /* Free with mm_free_sized */
+            sized_mode = true;
+            break;
+        case 'B': /* Group runs of like ops into batches */
+            batch_mode = true;
+            break;
+        case 'G': /* Pass the lifetime hints of the trace */
+            hint_mode = true;
+            break;
+        case 'g': /* Pass lifetime hints derived from when blocks die */
+            hint_mode = true;
+            auto_hint = true;
+            break;
+
         case 'h': /* Print this message */
             usage(argv[0]);
             exit(0);
@@ -518,6 +619,21 @@ int main(int argc, char **argv)
             printf("\nResults for mm malloc:\n");
             printresults(num_global_tracefiles, mm_stats, &global_mm_sum_stats);
             printf("\n");
+            if (latency_mode && !sparse_mode) {
+                printf("Latency for mm malloc (nsecs per operation):\n");
+                printlatency(num_global_tracefiles, mm_stats);
+                printf("\n");
+            }
+            if (realloc_mode) {
+                printf("Realloc copy traffic for mm malloc (KB copied during the util run):\n");
+                printrealloc(num_global_tracefiles, mm_stats);
+                printf("\n");
+            }
+            if (heap_mode) {
+                printf("Heap size for mm malloc (during the util run):\n");
+                printheap(num_global_tracefiles, mm_stats);
+                printf("\n");
+            }
         }
     }
 
@@ -711,9 +827,10 @@ static bool add_range(range_set_t *ranges, char *lo, size_t size,
         return false;
     }
 
-    /* The payload must lie within the extent of the heap */
-    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) ||
-        (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) {
+    /* The payload must lie within the extent of the heap or of a mapped region */
+    if (((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) ||
+         (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) &&
+        !mem_is_mapped(lo, hi)) {
         malloc_error(trace, opnum,
                      "Payload (%p:%p) lies outside heap (%p:%p)",
                      lo, hi, mem_heap_lo(), mem_heap_hi());
@@ -875,6 +992,25 @@ static bool check_index(const trace_t *trace, int opnum, int index) {
     return true;
 }
 
+/*
+ * check_zero - check that every byte of a block returned by mm_calloc is zero
+ */
+static bool check_zero(const trace_t *trace, int opnum, int index) {
+    unsigned char *block = (unsigned char *) trace->blocks[index];
+    size_t size = trace->block_sizes[index];
+    size_t i;
+
+    for (i = 0; i < size; i += sizeof(uint64_t)) {
+        size_t len = size - i < sizeof(uint64_t) ? size - i : sizeof(uint64_t);
+        if (mem_read(block + i, len) != 0) {
+            malloc_error(trace, opnum, "mm_calloc block %d (at %p) is not zero "
+                         "at byte %zu", index, block, i);
+            return false;
+        }
+    }
+    return true;
+}
+
 /**********************************************
  * The following routines manipulate tracefiles
  *********************************************/
@@ -888,8 +1024,13 @@ static trace_t *read_trace(stats_t *stats, const char *tracedir,
     FILE *tracefile;
     trace_t *trace;
     char type[MAXLINE];
+    char rest[MAXLINE];
     int index;
+    int last, id;
+    int lifetime;
+    int *death;
     size_t size;
+    size_t align;
     int max_index = 0;
     int op_index;
     int ignore = 0;
@@ -938,17 +1079,51 @@ static trace_t *read_trace(stats_t *stats, const char *tracedir,
          calloc(trace->num_ids, sizeof(*trace->block_rand_base))) == NULL)
         unix_error("malloc 5 failed in read_trace");
 
+    /* No id belongs to an arena until an arena line says so */
+    if ((trace->block_arena =
+         malloc(trace->num_ids * sizeof(*trace->block_arena))) == NULL)
+        unix_error("malloc 6 failed in read_trace");
+    memset(trace->block_arena, -1, trace->num_ids * sizeof(*trace->block_arena));
+    trace->num_arenas = 0;
+
 
     /* read every request line in the trace file */
     index = 0;
     op_index = 0;
     while (fscanf(tracefile, "%s", type) != EOF) {
+        trace->ops[op_index].lifetime = 0;
         switch(type[0]) {
         case 'a':
             ignore += fscanf(tracefile, "%u %lu", &index, &size);
+            /* An optional lifetime hint ends the line */
+            lifetime = 0;
+            if (fgets(rest, MAXLINE, tracefile) != NULL &&
+                sscanf(rest, "%d", &lifetime) == 1 &&
+                (lifetime < 0 || lifetime >= MM_LIFETIMES))
+                app_error("Lifetime hint %d out of range in tracefile %s\n",
+                          lifetime, trace->filename);
             trace->ops[op_index].type = ALLOC;
             trace->ops[op_index].index = index;
             trace->ops[op_index].size = size;
+            trace->ops[op_index].lifetime = hint_mode ? lifetime : 0;
+            max_index = (index > max_index) ? index : max_index;
+            break;
+        case 'c':
+            ignore += fscanf(tracefile, "%u %lu", &index, &size);
+            trace->ops[op_index].type = CALLOC;
+            trace->ops[op_index].index = index;
+            trace->ops[op_index].size = size;
+            max_index = (index > max_index) ? index : max_index;
+            break;
+        case 'm':
+            ignore += fscanf(tracefile, "%u %lu %lu", &index, &align, &size);
+            if (align == 0 || (align & (align - 1)) != 0)
+                app_error("Alignment %lu is not a power of two in tracefile %s\n",
+                          align, trace->filename);
+            trace->ops[op_index].type = MEMALIGN;
+            trace->ops[op_index].index = index;
+            trace->ops[op_index].size = size;
+            trace->ops[op_index].align = align;
             max_index = (index > max_index) ? index : max_index;
             break;
         case 'r':
@@ -962,11 +1137,33 @@ static trace_t *read_trace(stats_t *stats, const char *tracedir,
             ignore += fscanf(tracefile, "%u", &index);
             trace->ops[op_index].type = FREE;
             trace->ops[op_index].index = index;
+            trace->ops[op_index].size = 0;
+            break;
+        case 'A':
+            ignore += fscanf(tracefile, "%u %u", &index, &last);
+            if (index > last || last >= trace->num_ids)
+                app_error("Bad arena id range %d..%d in tracefile %s\n",
+                          index, last, trace->filename);
+            for (id = index; id <= last; id++)
+                trace->block_arena[id] = trace->num_arenas;
+            trace->ops[op_index].type = ARENA;
+            trace->ops[op_index].index = trace->num_arenas++;
+            trace->ops[op_index].size = 0;
+            index = -1; /* names no block */
             break;
         default:
             app_error("Bogus type character (%c) in tracefile %s\n",
                       type[0], trace->filename);
         }
+        /* A free carries the size of its block, for mm_free_sized */
+        if (index >= 0 && index < trace->num_ids) {
+            if (trace->ops[op_index].type == FREE)
+                trace->ops[op_index].size = trace->block_sizes[index];
+            else {
+                trace->ops[op_index].old_size = trace->block_sizes[index];
+                trace->block_sizes[index] = trace->ops[op_index].size;
+            }
+        }
         op_index++;
         if (op_index == trace->num_ops) break;
     }
@@ -974,6 +1171,54 @@ static trace_t *read_trace(stats_t *stats, const char *tracedir,
     assert(max_index == trace->num_ids - 1);
     assert(trace->num_ops == op_index);
 
+    /* The arenas are created as their ARENA ops are run */
+    if ((trace->arenas = calloc(trace->num_arenas, sizeof(*trace->arenas))) == NULL ||
+        (trace->arena_live = calloc(trace->num_arenas, sizeof(*trace->arena_live))) == NULL ||
+        (trace->arena_last_op = calloc(trace->num_arenas, sizeof(*trace->arena_last_op))) == NULL ||
+        (trace->spare_arenas = calloc(trace->num_arenas, sizeof(*trace->spare_arenas))) == NULL)
+        unix_error("malloc 7 failed in read_trace");
+    for (op_index = 0; op_index < trace->num_ops; op_index++) {
+        index = trace->ops[op_index].index;
+        if (trace->ops[op_index].type != ARENA && arena_owned(trace, index))
+            trace->arena_last_op[trace->block_arena[index]] = op_index;
+    }
+
+    /* With -g, a malloc is tagged by the ops until its block is freed or
+       reallocated, and arena blocks are left to their arenas */
+    if (auto_hint) {
+        if ((death = malloc(trace->num_ids * sizeof(*death))) == NULL)
+            unix_error("malloc 8 failed in read_trace");
+        for (id = 0; id < trace->num_ids; id++)
+            death[id] = -1;
+        for (op_index = trace->num_ops - 1; op_index >= 0; op_index--) {
+            traceop_t *op = &trace->ops[op_index];
+            long life;
+            if (op->type == ARENA || op->index < 0)
+                continue;
+            life = death[op->index] - op_index;
+            if (op->type == ALLOC && !arena_owned(trace, op->index))
+                op->lifetime = (death[op->index] < 0) ? 0 :
+                    (life < HINT_SHORT) ? 1 :
+                    (life < HINT_MEDIUM) ? 2 :
+                    (life < HINT_LONG) ? 3 : 0;
+            death[op->index] = op_index;
+        }
+        free(death);
+    }
+
+    /* Count the run of mallocs of one size, or of frees, each op starts;
+       blocks of arenas and hinted mallocs are left out of batches */
+    for (op_index = trace->num_ops - 1; op_index >= 0; op_index--) {
+        traceop_t *op = &trace->ops[op_index];
+        traceop_t *next = op + 1;
+        op->batch = 1;
+        if (op_index + 1 < trace->num_ops && op->type == next->type &&
+            !arena_owned(trace, op->index) && !arena_owned(trace, next->index) &&
+            (op->type == FREE || (op->type == ALLOC && op->size == next->size &&
+                                  op->lifetime == 0 && next->lifetime == 0)))
+            op->batch += next->batch;
+    }
+
     /* fill in the stats */
     strcpy(stats->filename, trace->filename);
     stats->weight = trace->weight;
@@ -990,6 +1235,10 @@ static void reinit_trace(trace_t *trace)
     memset(trace->blocks, 0, trace->num_ids * sizeof(*trace->blocks));
     memset(trace->block_sizes, 0, trace->num_ids * sizeof(*trace->block_sizes));
     /* block_rand_base is unused if size is zero */
+    batch_next = batch_count = batch_freed = 0;
+    memset(trace->arenas, 0, trace->num_arenas * sizeof(*trace->arenas));
+    memset(trace->arena_live, 0, trace->num_arenas * sizeof(*trace->arena_live));
+    trace->num_spare = 0;
 }
 
 /*
@@ -1002,9 +1251,168 @@ static void free_trace(trace_t *trace)
     free(trace->blocks);
     free(trace->block_sizes);
     free(trace->block_rand_base);
+    free(trace->block_arena);
+    free(trace->arenas);
+    free(trace->arena_live);
+    free(trace->arena_last_op);
+    free(trace->spare_arenas);
     free(trace);              /* and the trace record itself... */
 }
 
+/*
+ * batch_length - number of ops, starting at opnum, that -B runs as one batch
+ */
+static long batch_length(const trace_t *trace, int opnum)
+{
+    long n = trace->ops[opnum].batch;
+    return (n < BATCH_MAX) ? n : BATCH_MAX;
+}
+
+/*
+ * batch_malloc - return the block of malloc op opnum. The first op of a
+ *     run gets the blocks of the whole run from one mm_malloc_batch call,
+ *     and the later ops take theirs in turn.
+ */
+static char *batch_malloc(const trace_t *trace, int opnum)
+{
+    if (batch_next == batch_count) {
+        batch_count = mm_malloc_batch(trace->ops[opnum].size,
+                                      batch_length(trace, opnum), batch_blocks);
+        batch_next = 0;
+        if (batch_count == 0)
+            return NULL;
+    }
+    return batch_blocks[batch_next++];
+}
+
+/*
+ * batch_free - free the block of op opnum. The first free of a run frees
+ *     the blocks of the whole run with one mm_free_batch call, and the
+ *     later frees do nothing.
+ */
+static void batch_free(const trace_t *trace, int opnum)
+{
+    long i, n;
+    long index;
+
+    if (batch_freed > 0) {
+        batch_freed--;
+        return;
+    }
+    n = batch_length(trace, opnum);
+    for (i = 0; i < n; i++) {
+        index = trace->ops[opnum + i].index;
+        batch_blocks[i] = (index < 0) ? NULL : trace->blocks[index];
+    }
+    mm_free_batch(batch_blocks, n);
+    batch_freed = n - 1;
+}
+
+/*
+ * arena_owned - true if the block of id index is allocated from an arena
+ */
+static bool arena_owned(const trace_t *trace, long index)
+{
+    return index >= 0 && trace->block_arena[index] >= 0;
+}
+
+/*
+ * arena_start - get the arena declared by ARENA op opnum: a spare one if
+ *     an earlier arena is done, like a server reusing its arena for the
+ *     next request, or else a new one
+ */
+static bool arena_start(trace_t *trace, int opnum)
+{
+    mm_arena_t *arena;
+
+    if (trace->num_spare > 0)
+        arena = trace->spare_arenas[--trace->num_spare];
+    else
+        arena = mm_arena_create();
+    trace->arenas[trace->ops[opnum].index] = arena;
+    return arena != NULL;
+}
+
+/*
+ * arena_alloc - run malloc, calloc or realloc op opnum, whose id belongs
+ *     to an arena, with mm_arena_alloc. A realloc copies the old block to
+ *     the new one, and one to size 0 frees it. Returns the new block, or
+ *     NULL if there is none.
+ */
+static char *arena_alloc(trace_t *trace, int opnum)
+{
+    const traceop_t *op = &trace->ops[opnum];
+    int arena = trace->block_arena[op->index];
+    char *oldp = (op->type == REALLOC) ? trace->blocks[op->index] : NULL;
+    char *p;
+
+    if (trace->arenas[arena] == NULL)
+        app_error("Block %ld is allocated before its arena line in tracefile %s",
+                  op->index, trace->filename);
+    if (op->type == MEMALIGN)
+        app_error("Block %ld of an arena is allocated by memalign in tracefile %s",
+                  op->index, trace->filename);
+    if (op->type == REALLOC && op->size == 0) {
+        if (oldp != NULL)
+            arena_free(trace, opnum);
+        return NULL;
+    }
+    if ((p = mm_arena_alloc(trace->arenas[arena], op->size)) == NULL)
+        return NULL;
+    if (op->type == CALLOC)
+        memset(p, 0, op->size);
+    if (oldp != NULL)
+        memcpy(p, oldp, op->old_size < op->size ? op->old_size : op->size);
+    else
+        trace->arena_live[arena]++;
+    return p;
+}
+
+/*
+ * arena_free - free the block of free or realloc op opnum, which belongs
+ *     to an arena. The block stays until the last block of the arena is
+ *     freed, which resets the arena. If no request for its ids is left,
+ *     the arena is kept as a spare for the next arena line.
+ */
+static void arena_free(trace_t *trace, int opnum)
+{
+    int arena = trace->block_arena[trace->ops[opnum].index];
+
+    if (--trace->arena_live[arena] > 0)
+        return;
+    mm_arena_reset(trace->arenas[arena]);
+    if (opnum == trace->arena_last_op[arena]) {
+        trace->spare_arenas[trace->num_spare++] = trace->arenas[arena];
+        trace->arenas[arena] = NULL;
+    }
+}
+
+/*
+ * arena_op - run op opnum if it is an ARENA op or an op on a block of an
+ *     arena, and return true; return false for any other op
+ */
+static bool arena_op(trace_t *trace, int opnum)
+{
+    const traceop_t *op = &trace->ops[opnum];
+    char *p;
+
+    if (op->type == ARENA) {
+        if (!arena_start(trace, opnum))
+            app_error("mm_arena_create failed");
+        return true;
+    }
+    if (!arena_owned(trace, op->index))
+        return false;
+    if (op->type == FREE) {
+        arena_free(trace, opnum);
+        return true;
+    }
+    if ((p = arena_alloc(trace, opnum)) == NULL && op->size != 0)
+        app_error("mm_arena_alloc failed");
+    trace->blocks[op->index] = p;
+    return true;
+}
+
 /**********************************************************************
  * The following functions evaluate the correctness, space utilization,
  * and throughput of the libc and mm malloc packages.
@@ -1015,9 +1423,9 @@ static void free_trace(trace_t *trace)
  */
 static bool eval_mm_valid(trace_t *trace, range_set_t *ranges)
 {
-    int i;
+    int i, j;
     int index;
-    size_t size;
+    size_t size, usable;
     char *newp;
     char *oldp;
     char *p;
@@ -1061,25 +1469,57 @@ static bool eval_mm_valid(trace_t *trace, range_set_t *ranges)
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_malloc */
-
-            /* Call the student's malloc */
-            if ((p = mm_malloc(size)) == NULL) {
+        case CALLOC: /* mm_calloc */
+        case MEMALIGN: /* mm_memalign */
+
+            /* Call the student's malloc, calloc or memalign */
+            if (arena_owned(trace, index))
+                p = arena_alloc(trace, i);
+            else if (trace->ops[i].type == CALLOC)
+                p = mm_calloc(1, size);
+            else if (trace->ops[i].type == MEMALIGN)
+                p = mm_memalign(trace->ops[i].align, size);
+            else if (trace->ops[i].lifetime > 0)
+                p = mm_malloc_hint(size, trace->ops[i].lifetime);
+            else if (batch_mode)
+                p = batch_malloc(trace, i);
+            else
+                p = mm_malloc(size);
+            if (p == NULL) {
                 malloc_error(trace, i, "mm_malloc failed.");
                 return false;
             }
 
+            if (trace->ops[i].type == MEMALIGN &&
+                ((unsigned long) p) % trace->ops[i].align != 0) {
+                malloc_error(trace, i, "Payload address (%p) not aligned to %zu bytes",
+                             p, trace->ops[i].align);
+                return false;
+            }
+
             /*
              * Test the range of the new block for correctness and add it
              * to the range list if OK. The block must be  be aligned properly,
-             * and must not overlap any currently allocated block.
+             * and must not overlap any currently allocated block, up to the
+             * end of the usable size that mm_usable_size reports, or of
+             * the size asked for in an arena.
              */
-            if (add_range(ranges, p, size, trace, i, index) == 0)
+            usable = arena_owned(trace, index) ? size : mm_usable_size(p);
+            if (usable < size) {
+                malloc_error(trace, i, "mm_usable_size (%zu) is below the size asked for",
+                             usable);
+                return false;
+            }
+            if (add_range(ranges, p, usable, trace, i, index) == 0)
                 return false;
 
             /* Remember region */
             trace->blocks[index] = p;
             trace->block_sizes[index] = size;
 
+            if (trace->ops[i].type == CALLOC && !check_zero(trace, i, index))
+                return false;
+
             /* Set to random data, for debugging. */
             randomize_block(trace, index);
             break;
@@ -1092,7 +1532,10 @@ static bool eval_mm_valid(trace_t *trace, range_set_t *ranges)
 
             /* Call the student's realloc */
             oldp = trace->blocks[index];
-            newp = mm_realloc(oldp, size);
+            if (arena_owned(trace, index))
+                newp = arena_alloc(trace, i);
+            else
+                newp = mm_realloc(oldp, size);
             if ( (newp == NULL) && (size != 0) ) {
                 malloc_error(trace, i, "mm_realloc failed.");
                 return false;
@@ -1108,7 +1551,13 @@ static bool eval_mm_valid(trace_t *trace, range_set_t *ranges)
 
             /* Check new block for correctness and add it to range list */
             if (size > 0) {
-                if (add_range(ranges, newp, size, trace, i, index) == 0)
+                usable = arena_owned(trace, index) ? size : mm_usable_size(newp);
+                if (usable < size) {
+                    malloc_error(trace, i, "mm_usable_size (%zu) is below the size asked for",
+                                 usable);
+                    return false;
+                }
+                if (add_range(ranges, newp, usable, trace, i, index) == 0)
                     return false;
             }
 
@@ -1132,6 +1581,21 @@ static bool eval_mm_valid(trace_t *trace, range_set_t *ranges)
             break;
 
         case FREE: /* mm_free */
+            if (batch_mode && !arena_owned(trace, index)) {
+                /* The first free of a run frees all of it, so check it all now */
+                if (batch_freed == 0) {
+                    for (j = i; j < i + batch_length(trace, i); j++) {
+                        if (!check_index(trace, j, trace->ops[j].index))
+                        {
+                            allCheck = false;
+                        }
+                        if (trace->ops[j].index >= 0)
+                            remove_range(ranges, trace->blocks[trace->ops[j].index]);
+                    }
+                }
+                batch_free(trace, i);
+                break;
+            }
             if (!check_index(trace, i, index))
             {
                 allCheck = false;
@@ -1144,13 +1608,37 @@ static bool eval_mm_valid(trace_t *trace, range_set_t *ranges)
                 p = trace->blocks[index];
                 remove_range(ranges, p);
             }
-            mm_free(p);
+            if (arena_owned(trace, index))
+                arena_free(trace, i);
+            else if (sized_mode)
+                mm_free_sized(p, size);
+            else
+                mm_free(p);
+            break;
+
+        case ARENA: /* mm_arena_create */
+            if (!arena_start(trace, i)) {
+                malloc_error(trace, i, "mm_arena_create failed.");
+                return false;
+            }
             break;
 
         default:
             app_error("Nonexistent request type in eval_mm_valid");
         }
     }
+
+    /* Destroy the arenas, with any blocks they still hold */
+    for (i = 0; i < trace->num_arenas; i++)
+        mm_arena_destroy(trace->arenas[i]);
+    for (i = 0; i < trace->num_spare; i++)
+        mm_arena_destroy(trace->spare_arenas[i]);
+    if (trace->num_arenas > 0 && !mm_checkheap(0)) {
+        malloc_error(trace, trace->num_ops - 1, "mm_checkheap returned false "
+                     "after mm_arena_destroy\n");
+        return false;
+    }
+
     /* As far as we know, this is a valid malloc package */
     return allCheck;
 }
@@ -1160,24 +1648,29 @@ static bool eval_mm_valid(trace_t *trace, range_set_t *ranges)
  *   The idea is to remember the high water mark "hwm" of the heap for
  *   an optimal allocator, i.e., no gaps and no internal fragmentation.
  *   Utilization is the ratio hwm/heapsize, where heapsize is the
- *   size of the heap in bytes after running the student's malloc
- *   package on the trace. Note that our implementation of mem_sbrk()
- *   doesn't allow the students to decrement the brk pointer, so brk
- *   is always the high water mark of the heap.
+ *   largest size of the heap in bytes while running the student's malloc
+ *   package on the trace, counting regions mapped by mem_map(). mem_sbrk()
+ *   lets the heap shrink, so the final brk can be below this high water
+ *   mark; the final and the time-averaged heap sizes are recorded in
+ *   stats as well.
  *
  *   A higher number is better: 1 is optimal.
  */
-static double eval_mm_util(trace_t *trace, int tracenum)
+static double eval_mm_util(trace_t *trace, int tracenum, stats_t *stats)
 {
     int i;
     int index;
     size_t size, newsize, oldsize;
     size_t max_total_size = 0;
     size_t total_size = 0;
+    double heap_sum = 0;
     char *p;
     char *newp, *oldp;
 
     reinit_trace(trace);
+    stats->realloc_ops = 0;
+    stats->copy_naive = 0;
+    stats->realloc_fits = 0;
 
     /* initialize the heap and the mm malloc package */
     mem_reset_brk();
@@ -1188,10 +1681,24 @@ static double eval_mm_util(trace_t *trace, int tracenum)
         switch (trace->ops[i].type) {
 
         case ALLOC: /* mm_alloc */
+        case CALLOC: /* mm_calloc */
+        case MEMALIGN: /* mm_memalign */
             index = trace->ops[i].index;
             size = trace->ops[i].size;
 
-            if ((p = mm_malloc(size)) == NULL) {
+            if (arena_owned(trace, index))
+                p = arena_alloc(trace, i);
+            else if (trace->ops[i].type == CALLOC)
+                p = mm_calloc(1, size);
+            else if (trace->ops[i].type == MEMALIGN)
+                p = mm_memalign(trace->ops[i].align, size);
+            else if (trace->ops[i].lifetime > 0)
+                p = mm_malloc_hint(size, trace->ops[i].lifetime);
+            else if (batch_mode)
+                p = batch_malloc(trace, i);
+            else
+                p = mm_malloc(size);
+            if (p == NULL) {
                 app_error("trace %d: mm_malloc failed in eval_mm_util",
                           tracenum);
             }
@@ -1209,7 +1716,14 @@ static double eval_mm_util(trace_t *trace, int tracenum)
             oldsize = trace->block_sizes[index];
 
             oldp = trace->blocks[index];
-            if ((newp = mm_realloc(oldp,newsize)) == NULL && newsize != 0) {
+            if (arena_owned(trace, index))
+                newp = arena_alloc(trace, i);
+            else {
+                if (oldp != NULL && newsize <= mm_usable_size(oldp))
+                    stats->realloc_fits++;
+                newp = mm_realloc(oldp,newsize);
+            }
+            if (newp == NULL && newsize != 0) {
                 app_error("trace %d: mm_realloc failed in eval_mm_util",
                           tracenum);
             }
@@ -1218,6 +1732,10 @@ static double eval_mm_util(trace_t *trace, int tracenum)
             trace->blocks[index] = newp;
             trace->block_sizes[index] = newsize;
 
+            /* A realloc that always moves copies the smaller of the two sizes */
+            stats->realloc_ops++;
+            stats->copy_naive += (newsize < oldsize) ? newsize : oldsize;
+
             total_size += (newsize - oldsize);
             break;
 
@@ -1231,11 +1749,24 @@ static double eval_mm_util(trace_t *trace, int tracenum)
                 p = trace->blocks[index];
             }
 
-            mm_free(p);
+            if (arena_owned(trace, index))
+                arena_free(trace, i);
+            else if (batch_mode)
+                batch_free(trace, i);
+            else if (sized_mode)
+                mm_free_sized(p, size);
+            else
+                mm_free(p);
 
             total_size -= size;
             break;
 
+        case ARENA: /* mm_arena_create */
+            if (!arena_start(trace, i))
+                app_error("trace %d: mm_arena_create failed in eval_mm_util",
+                          tracenum);
+            break;
+
         default:
             app_error("trace %d: Nonexistent request type in eval_mm_util",
                       tracenum);
@@ -1244,13 +1775,19 @@ static double eval_mm_util(trace_t *trace, int tracenum)
         /* update the high-water mark */
         max_total_size = (total_size > max_total_size) ?
             total_size : max_total_size;
+        heap_sum += mem_heapsize() + mem_mapped_bytes();
     }
 
 #if !REF_ONLY
     printf(".");
 #endif
 
-    return ((double)max_total_size / (double)mem_heapsize());
+    stats->copy_bytes = mem_copy_bytes();
+    stats->sbrk_calls = mem_sbrk_calls();
+    stats->heap_bytes = mem_heapsize() + mem_mapped_bytes();
+    stats->heap_avg = trace->num_ops == 0 ? 0 : heap_sum / trace->num_ops;
+    stats->heap_peak = mem_heap_peak();
+    return ((double)max_total_size / (double)mem_heap_peak());
 }
 
 
@@ -1272,39 +1809,168 @@ static void eval_mm_speed(void *ptr)
         app_error("mm_init failed in eval_mm_speed");
 
     /* Interpret each trace request */
-    for (i = 0;  i < trace->num_ops;  i++)
+    for (i = 0;  i < trace->num_ops;  i++) {
+        /* Arena lines and blocks of arenas go to the arenas */
+        if (trace->num_arenas > 0 && arena_op(trace, i))
+            continue;
+
         switch (trace->ops[i].type) {
 
-        case ALLOC: /* mm_malloc */
-            index = trace->ops[i].index;
-            size = trace->ops[i].size;
-            if ((p = mm_malloc(size)) == NULL)
-                app_error("mm_malloc error in eval_mm_speed");
-            trace->blocks[index] = p;
-            break;
+            case ALLOC: /* mm_malloc */
+                index = trace->ops[i].index;
+                size = trace->ops[i].size;
+                if (trace->ops[i].lifetime > 0)
+                    p = mm_malloc_hint(size, trace->ops[i].lifetime);
+                else
+                    p = batch_mode ? batch_malloc(trace, i) : mm_malloc(size);
+                if (p == NULL)
+                    app_error("mm_malloc error in eval_mm_speed");
+                trace->blocks[index] = p;
+                break;
 
-        case REALLOC: /* mm_realloc */
-            index = trace->ops[i].index;
-            newsize = trace->ops[i].size;
-            oldp = trace->blocks[index];
-            if ((newp = mm_realloc(oldp,newsize)) == NULL && newsize != 0)
-                app_error("mm_realloc error in eval_mm_speed");
-            trace->blocks[index] = newp;
-            break;
+            case CALLOC: /* mm_calloc */
+                index = trace->ops[i].index;
+                size = trace->ops[i].size;
+                if ((p = mm_calloc(1, size)) == NULL)
+                    app_error("mm_calloc error in eval_mm_speed");
+                trace->blocks[index] = p;
+                break;
 
-        case FREE: /* mm_free */
+            case MEMALIGN: /* mm_memalign */
+                index = trace->ops[i].index;
+                size = trace->ops[i].size;
+                if ((p = mm_memalign(trace->ops[i].align, size)) == NULL)
+                    app_error("mm_memalign error in eval_mm_speed");
+                trace->blocks[index] = p;
+                break;
+
+            case REALLOC: /* mm_realloc */
+                index = trace->ops[i].index;
+                newsize = trace->ops[i].size;
+                oldp = trace->blocks[index];
+                if ((newp = mm_realloc(oldp,newsize)) == NULL && newsize != 0)
+                    app_error("mm_realloc error in eval_mm_speed");
+                trace->blocks[index] = newp;
+                break;
+
+            case FREE: /* mm_free */
+                index = trace->ops[i].index;
+                if (index < 0) {
+                    block = 0;
+                } else {
+                    block = trace->blocks[index];
+                }
+                if (batch_mode)
+                    batch_free(trace, i);
+                else if (sized_mode)
+                    mm_free_sized(block, trace->ops[i].size);
+                else
+                    mm_free(block);
+                break;
+
+            default:
+                app_error("Nonexistent request type in eval_mm_speed");
+        }
+    }
+}
+
+/*
+ * cmp_double - qsort comparison for latency samples
+ */
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * eval_mm_latency - Replay the trace timing every request on its own,
+ *    and record the median, 99th, 99.9th percentile and maximum latency.
+ *    The trace is replayed LATENCY_RUNS times and the lowest value of
+ *    each percentile is kept, to filter out interrupts and page faults.
+ *    The median cost of reading the timer itself is subtracted.
+ */
+static void eval_mm_latency(trace_t *trace, stats_t *stats)
+{
+    int i, run, index;
+    size_t size;
+    char *p;
+    bool arena;
+    double t;
+    double *lat;
+
+    if ((lat = (double *) malloc(trace->num_ops * sizeof(double))) == NULL)
+        unix_error("malloc failed in eval_mm_latency");
+
+    for (i = 0; i < trace->num_ops; i++) {
+        start_timer();
+        lat[i] = get_timer() * 1e9;
+    }
+    qsort(lat, trace->num_ops, sizeof(double), cmp_double);
+    double overhead = lat[trace->num_ops / 2];
+
+    stats->lat_p50 = stats->lat_p99 = stats->lat_p999 = stats->lat_max = DBL_MAX;
+    for (run = 0; run < LATENCY_RUNS; run++) {
+        reinit_trace(trace);
+        mem_reset_brk();
+        if (!mm_init())
+            app_error("mm_init failed in eval_mm_latency");
+
+        for (i = 0;  i < trace->num_ops;  i++) {
             index = trace->ops[i].index;
-            if (index < 0) {
-                block = 0;
-            } else {
-                block = trace->blocks[index];
+            size = trace->ops[i].size;
+            start_timer();
+            arena = trace->num_arenas > 0 && arena_op(trace, i);
+            if (!arena) {
+                switch (trace->ops[i].type) {
+                case ALLOC: /* mm_malloc */
+                    if (trace->ops[i].lifetime > 0)
+                        p = mm_malloc_hint(size, trace->ops[i].lifetime);
+                    else
+                        p = mm_malloc(size);
+                    break;
+                case CALLOC: /* mm_calloc */
+                    p = mm_calloc(1, size);
+                    break;
+                case MEMALIGN: /* mm_memalign */
+                    p = mm_memalign(trace->ops[i].align, size);
+                    break;
+                case REALLOC: /* mm_realloc */
+                    p = mm_realloc(trace->blocks[index], size);
+                    break;
+                case FREE: /* mm_free */
+                    p = NULL;
+                    if (sized_mode)
+                        mm_free_sized(index < 0 ? NULL : trace->blocks[index], size);
+                    else
+                        mm_free(index < 0 ? NULL : trace->blocks[index]);
+                    break;
+                default:
+                    app_error("Nonexistent request type in eval_mm_latency");
+                }
             }
-            mm_free(block);
-            break;
-
-        default:
-            app_error("Nonexistent request type in eval_mm_speed");
+            t = get_timer();
+            if (!arena && trace->ops[i].type != FREE) {
+                if (p == NULL && size != 0)
+                    app_error("mm_malloc error in eval_mm_latency");
+                trace->blocks[index] = p;
+            }
+            lat[i] = t * 1e9 > overhead ? t * 1e9 - overhead : 0.0;
         }
+
+        qsort(lat, trace->num_ops, sizeof(double), cmp_double);
+        int n = trace->num_ops;
+        double p50 = lat[(int) (0.5 * (n - 1))];
+        double p99 = lat[(int) (0.99 * (n - 1))];
+        double p999 = lat[(int) (0.999 * (n - 1))];
+        double pmax = lat[n - 1];
+        stats->lat_p50 = p50 < stats->lat_p50 ? p50 : stats->lat_p50;
+        stats->lat_p99 = p99 < stats->lat_p99 ? p99 : stats->lat_p99;
+        stats->lat_p999 = p999 < stats->lat_p999 ? p999 : stats->lat_p999;
+        stats->lat_max = pmax < stats->lat_max ? pmax : stats->lat_max;
+    }
+    free(lat);
 }
 
 /*
@@ -1332,6 +1998,22 @@ static bool eval_libc_valid(trace_t *trace)
             trace->blocks[trace->ops[i].index] = p;
             break;
 
+        case CALLOC: /* calloc */
+            if ((p = calloc(1, trace->ops[i].size)) == NULL) {
+                malloc_error(trace, i, "libc calloc failed");
+                unix_error("System message");
+            }
+            trace->blocks[trace->ops[i].index] = p;
+            break;
+
+        case MEMALIGN: /* aligned_alloc */
+            if ((p = aligned_alloc(trace->ops[i].align, trace->ops[i].size)) == NULL) {
+                malloc_error(trace, i, "libc aligned_alloc failed");
+                unix_error("System message");
+            }
+            trace->blocks[trace->ops[i].index] = p;
+            break;
+
         case REALLOC: /* realloc */
             newsize = trace->ops[i].size;
             oldp = trace->blocks[trace->ops[i].index];
@@ -1350,6 +2032,9 @@ static bool eval_libc_valid(trace_t *trace)
             }
             break;
 
+        case ARENA: /* libc has no arenas, their blocks use malloc */
+            break;
+
         default:
             app_error("invalid operation type  in eval_libc_valid");
         }
@@ -1383,6 +2068,22 @@ static void eval_libc_speed(void *ptr)
             trace->blocks[index] = p;
             break;
 
+        case CALLOC: /* calloc */
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((p = calloc(1, size)) == NULL)
+                unix_error("calloc failed in eval_libc_speed");
+            trace->blocks[index] = p;
+            break;
+
+        case MEMALIGN: /* aligned_alloc */
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((p = aligned_alloc(trace->ops[i].align, size)) == NULL)
+                unix_error("aligned_alloc failed in eval_libc_speed");
+            trace->blocks[index] = p;
+            break;
+
         case REALLOC: /* realloc */
             index = trace->ops[i].index;
             newsize = trace->ops[i].size;
@@ -1402,6 +2103,9 @@ static void eval_libc_speed(void *ptr)
                 free(0);
             }
             break;
+
+        case ARENA: /* libc has no arenas, their blocks use malloc */
+            break;
         }
     }
 }
@@ -1583,6 +2287,34 @@ static void printresults(int n, stats_t *stats, sum_stats_t *sumstats)
     }
 }
 
+/*
+ * printlatency - prints the per-operation latency percentiles measured
+ *                by eval_mm_latency for every valid trace.
+ */
+static void printlatency(int n, stats_t *stats)
+{
+    int i;
+
+    if (tab_mode) {
+        printf("p50\tp99\tp99.9\tmax\ttrace\n");
+    } else {
+        printf("  %8s%8s%8s%10s  %s\n", "p50", "p99", "p99.9", "max", "trace");
+    }
+    for (i = 0; i < n; i++) {
+        if (!stats[i].valid)
+            continue;
+        if (tab_mode) {
+            printf("%.0f\t%.0f\t%.0f\t%.0f\t%s\n",
+                   stats[i].lat_p50, stats[i].lat_p99, stats[i].lat_p999,
+                   stats[i].lat_max, stats[i].filename);
+        } else {
+            printf("  %8.0f%8.0f%8.0f%10.0f  %s\n",
+                   stats[i].lat_p50, stats[i].lat_p99, stats[i].lat_p999,
+                   stats[i].lat_max, stats[i].filename);
+        }
+    }
+}
+
 /*
  * app_error - Report an arbitrary application error
  */
@@ -1799,6 +2531,64 @@ static double measure_ref_throughput(bool checkpoint) {
 }
 
 
+/*
+ * printrealloc - Print realloc copy traffic per trace
+ */
+static void printrealloc(int n, stats_t *stats)
+{
+    int i;
+
+    if (tab_mode) {
+        printf("reallocs\tfit\tnaive\tcopied\tsaved\ttrace\n");
+    } else {
+        printf("  %9s%7s%10s%10s%8s  %s\n", "reallocs", "fit", "naive", "copied", "saved", "trace");
+    }
+    for (i = 0; i < n; i++) {
+        if (!stats[i].valid || stats[i].realloc_ops == 0)
+            continue;
+        double saved = stats[i].copy_naive == 0 ? 0.0 :
+            100.0 * (stats[i].copy_naive - stats[i].copy_bytes) / stats[i].copy_naive;
+        double fit = 100.0 * stats[i].realloc_fits / stats[i].realloc_ops;
+        if (tab_mode) {
+            printf("%.0f\t%.1f\t%.1f\t%.1f\t%.1f\t%s\n",
+                   stats[i].realloc_ops, fit, stats[i].copy_naive / 1024.0,
+                   stats[i].copy_bytes / 1024.0, saved, stats[i].filename);
+        } else {
+            printf("  %9.0f%6.1f%%%10.1f%10.1f%7.1f%%  %s\n",
+                   stats[i].realloc_ops, fit, stats[i].copy_naive / 1024.0,
+                   stats[i].copy_bytes / 1024.0, saved, stats[i].filename);
+        }
+    }
+}
+/*
+ * printheap - Print mem_sbrk calls and final, average and peak heap size per trace
+ */
+static void printheap(int n, stats_t *stats)
+{
+    int i;
+
+    if (tab_mode) {
+        printf("sbrks\tfinalKB\tavgKB\tpeakKB\tutil\ttrace\n");
+    } else {
+        printf("  %8s%10s%10s%10s%8s  %s\n", "sbrks", "final KB", "avg KB", "peak KB",
+               "util", "trace");
+    }
+    for (i = 0; i < n; i++) {
+        if (!stats[i].valid)
+            continue;
+        if (tab_mode) {
+            printf("%.0f\t%.1f\t%.1f\t%.1f\t%.1f\t%s\n",
+                   stats[i].sbrk_calls, stats[i].heap_bytes / 1024.0,
+                   stats[i].heap_avg / 1024.0, stats[i].heap_peak / 1024.0,
+                   stats[i].util * 100.0, stats[i].filename);
+        } else {
+            printf("  %8.0f%10.1f%10.1f%10.1f%7.1f%%  %s\n",
+                   stats[i].sbrk_calls, stats[i].heap_bytes / 1024.0,
+                   stats[i].heap_avg / 1024.0, stats[i].heap_peak / 1024.0,
+                   stats[i].util * 100.0, stats[i].filename);
+        }
+    }
+}
 /*
  * usage - Explain the command line arguments
  */
@@ -1817,5 +2607,12 @@ static void usage(char *prog)
     fprintf(stderr, "\t-v <i>     Set Verbosity Level to <i>\n");
     fprintf(stderr, "\t-s <s>     Timeout after s secs (default no timeout)\n");
     fprintf(stderr, "\t-T         Print diagnostics in tab mode\n");
+    fprintf(stderr, "\t-L         Report per-operation latency percentiles.\n");
+    fprintf(stderr, "\t-R         Report bytes copied by realloc and reallocs that fit mm_usable_size.\n");
+    fprintf(stderr, "\t-H         Report mem_sbrk calls and final, average and peak heap size.\n");
+    fprintf(stderr, "\t-S         Free with mm_free_sized, passing the size the block was asked for.\n");
+    fprintf(stderr, "\t-B         Batch runs of same size mallocs and runs of frees (not with -L).\n");
+    fprintf(stderr, "\t-G         Pass the lifetime hints of mallocs in the trace to mm_malloc_hint.\n");
+    fprintf(stderr, "\t-g         Like -G, with hints derived from how many ops each block lives.\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file\n");
 }
@@ -5,6 +5,7 @@
  *
  * This version has been updated to enable sparse emulation of very large heaps
  */
+#define _GNU_SOURCE                         /* For mremap */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -34,12 +35,37 @@ static unsigned char *mem_max_addr;         /* Maximum allowable heap address */
 static size_t mmap_length = MAX_DENSE_HEAP; /* Number of bytes allocated by mmap */
 static bool show_stats = false;             /* Should program print allocation information? */
 static bool stats_printed = false;          /* Has information been printed about allocation */
+static size_t copy_bytes = 0;               /* Bytes moved by mem_memcpy since the last reset */
+static size_t sbrk_calls = 0;               /* Successful mem_sbrk calls since the last reset */
+static size_t mem_peak_size;                /* Largest heap plus mapped size since the last reset */
+
+/*
+ * Memory between fresh_lo and fresh_hi has never been handed out, so it still
+ * reads as zero.  The dense heap keeps its contents across resets, so only
+ * mem_init widens the range again there.
+ */
+static unsigned char *fresh_lo;             /* Highest break ever reached */
+static unsigned char *fresh_hi;             /* Lowest region ever mapped */
+static unsigned char *last_lo;              /* Fresh part of the latest mem_sbrk or mem_map */
+static unsigned char *last_hi;
+
+/* Regions mapped by mem_map, sorted by address, placed from mem_max_addr down */
+typedef struct {
+    unsigned char *lo;                      /* First byte of region */
+    size_t len;                             /* Length in bytes, a multiple of MAP_PAGE */
+} region_t;
+#define MAP_PAGE 4096                       /* Granularity of mapped regions */
+static region_t *regions = NULL;            /* Mapped regions */
+static size_t num_regions = 0;              /* Number of mapped regions */
+static size_t max_regions = 0;              /* Capacity of regions array */
+static size_t mapped_bytes = 0;             /* Total length of mapped regions */
 
 /* Sparse memory representation */
 static mem_block_t *next_free_page = NULL;  /* Next free page */
 static size_t num_pages = 0;                /* Total number of pages */
 static size_t num_free_pages = 0;           /* Number of free pages */
 static mem_block_t **page_table = NULL;     /* Hash table from page ID to page */
+static mem_block_t *released_pages = NULL;  /* Pages given back by mem_unmap */
 static size_t num_buckets = 0;              /* Number of buckets in page table */
 
 /*
@@ -48,6 +74,14 @@ static size_t num_buckets = 0;              /* Number of buckets in page table *
 static size_t page_id(const void *addr);
 static void *page_start(size_t id);
 static void *get_mem(const void *addr);
+static void release_pages(unsigned char *lo, size_t len);
+static void move_pages(unsigned char *lo, size_t len, unsigned char *new_lo);
+static bool move_mapping(unsigned char *lo, size_t len, unsigned char *new_lo);
+static bool emulated(const void *addr, size_t len);
+static size_t find_region(const unsigned char *lo);
+static unsigned char *find_gap(size_t len, size_t *index);
+static void update_peak(void);
+static void hand_out(unsigned char *lo, unsigned char *hi);
 static void print_stats();
 
 /* 
@@ -74,13 +108,13 @@ void mem_init(bool do_sparse){
         mmap_length = MAX_DENSE_HEAP;
     }
 
-    int dev_zero = open("/dev/zero", O_RDWR);
+    /* Anonymous, like the holes mem_remap plugs, so the kernel can merge them back */
     void *start = sparse ? NULL : TRY_DENSE_HEAP_START;
     void *addr = mmap(start,        /* suggested start*/
                       mmap_length,  /* length */
-                      PROT_WRITE,   /* permissions */
-                      MAP_PRIVATE,  /* private or shared? */
-                      dev_zero,            /* fd */
+                      PROT_READ | PROT_WRITE,       /* permissions */
+                      MAP_PRIVATE | MAP_ANONYMOUS,  /* private or shared? */
+                      -1,            /* fd */
                       0);            /* offset */
     if (addr == MAP_FAILED) {
         fprintf(stderr, "FAILURE.  mmap couldn't allocate space for heap\n");
@@ -95,6 +129,8 @@ void mem_init(bool do_sparse){
         heap = addr;
         mem_max_addr = heap + MAX_DENSE_HEAP;
     }
+    fresh_lo = heap;
+    fresh_hi = mem_max_addr;
     stats_printed = false;
     mem_brk = heap;
     mem_reset_brk();
@@ -106,7 +142,13 @@ void mem_init(bool do_sparse){
 void mem_deinit(void){
     print_stats();
     munmap(heap, mmap_length);
+    free(regions);
+    regions = NULL;
+    num_regions = 0;
+    max_regions = 0;
+    mapped_bytes = 0;
     next_free_page = NULL;
+    released_pages = NULL;
     num_free_pages = 0;
     page_table = NULL;
     num_buckets = 0;
@@ -124,32 +166,51 @@ void mem_reset_brk(){
         /* First page is just beyond page table */
         next_free_page = (mem_block_t *) ((unsigned char *) page_table + ptb);
         num_free_pages = num_pages;
+        released_pages = NULL;
+        /* Pages are zeroed when get_mem hands them out again */
+        fresh_lo = heap;
+        fresh_hi = mem_max_addr;
     }
+    last_lo = last_hi = heap;
     mem_brk = heap;
+    mem_peak_size = 0;
+    num_regions = 0;
+    mapped_bytes = 0;
+    copy_bytes = 0;
+    sbrk_calls = 0;
 }
 
 /* 
  * mem_sbrk - simple model of the sbrk function. Extends the heap 
- *                by incr bytes and returns the start address of the new area. In
- *                this model, the heap cannot be shrunk.
+ *                by incr bytes and returns the start address of the new area.
+ *                A negative incr shrinks the heap, but never below its start.
+ *                Only growth is passed on to the real sbrk: by then libc's own
+ *                heap may lie above the break, and shrinking it would take
+ *                memory away from the driver.
  */
 void *mem_sbrk(intptr_t incr) {
     unsigned char *old_brk = mem_brk;
 
     bool ok = true;
-    if (incr < 0) {
+    if (incr < 0 && (size_t) -incr > (size_t) (mem_brk - heap)) {
         ok = false;
-        fprintf(stderr, "ERROR: mem_sbrk failed.  Attempt to expand heap by negative value %ld\n", (long) incr);
-    } else if (mem_brk + incr > mem_max_addr) {
+        fprintf(stderr, "ERROR: mem_sbrk failed.  Attempt to shrink heap by %ld bytes, below its start\n", (long) -incr);
+    } else if (mem_brk + incr > (num_regions > 0 ? regions[0].lo : mem_max_addr)) {
         ok = false;
         size_t alloc = mem_brk - heap + incr;
         fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory.  Would require heap size of %zd (0x%zx) bytes\n", alloc, alloc);
-    } else if (!sparse && sbrk(incr) == (void*) -1) {
+    } else if (!sparse && incr > 0 && sbrk(incr) == (void*) -1) {
         ok = false;
         fprintf(stderr, "ERROR: mem_sbrk failed.  Could not allocate more heap space\n");
     }
     if (ok) {
+        if (incr > 0)
+            hand_out(mem_brk, mem_brk + incr);
         mem_brk += incr;
+        if (mem_brk > fresh_lo)
+            fresh_lo = mem_brk;
+        update_peak();
+        sbrk_calls++;
         return (void *) old_brk;
     } else {
         errno = ENOMEM;
@@ -178,6 +239,212 @@ size_t mem_heapsize() {
     return (size_t)(mem_brk - heap);
 }
 
+/*
+ * mem_heap_peak() - returns the largest heap size plus mapped size in bytes
+ *   since the heap was last reset
+ */
+size_t mem_heap_peak() {
+    return mem_peak_size;
+}
+
+/*
+ * mem_mapped_bytes() - returns the total length of regions mapped by mem_map
+ */
+size_t mem_mapped_bytes() {
+    return mapped_bytes;
+}
+
+/*
+ * mem_map - map a region of len bytes, rounded up to MAP_PAGE, outside the
+ *   brk heap.  Regions are placed from the top of the address space down,
+ *   in the highest gap that fits, so the heap can keep growing below them.
+ *   Pages are committed when they are first touched, by the OS in dense mode
+ *   and by get_mem in sparse mode.  Returns NULL on failure.
+ */
+void *mem_map(size_t len) {
+    len = (len + MAP_PAGE - 1) / MAP_PAGE * MAP_PAGE;
+    if (len == 0)
+        return NULL;
+    size_t i;
+    unsigned char *lo = find_gap(len, &i);
+    if (lo == NULL) {
+        fprintf(stderr, "ERROR: mem_map failed.  No room for a region of %zu bytes\n", len);
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (num_regions == max_regions) {
+        max_regions = max_regions == 0 ? 64 : 2 * max_regions;
+        regions = realloc(regions, max_regions * sizeof(region_t));
+        if (regions == NULL) {
+            fprintf(stderr, "FAILURE.  Ran out of memory for mapped regions\n");
+            exit(1);
+        }
+    }
+    memmove(&regions[i+1], &regions[i], (num_regions - i) * sizeof(region_t));
+    regions[i].lo = lo;
+    regions[i].len = len;
+    hand_out(lo, lo + len);
+    if (lo < fresh_hi)
+        fresh_hi = lo;
+    num_regions++;
+    mapped_bytes += len;
+    update_peak();
+    return (void *) regions[i].lo;
+}
+
+/*
+ * mem_unmap - unmap the region starting at addr that mem_map returned.
+ *   Sparse emulation takes back the pages that were touched.  In dense mode,
+ *   like a negative mem_sbrk, the region only stops counting towards the
+ *   heap size; its pages stay committed.  Neither mode zeroes memory that
+ *   is mapped again.
+ */
+void mem_unmap(void *addr, size_t len) {
+    unsigned char *lo = (unsigned char *) addr;
+    size_t l = find_region(lo);
+    if (l == num_regions || regions[l].lo != lo ||
+        regions[l].len != (len + MAP_PAGE - 1) / MAP_PAGE * MAP_PAGE) {
+        fprintf(stderr, "ERROR: mem_unmap failed.  No region of %zu bytes at %p\n", len, addr);
+        return;
+    }
+    len = regions[l].len;
+    if (sparse)
+        release_pages(lo, len);
+    memmove(&regions[l], &regions[l+1], (num_regions - l - 1) * sizeof(region_t));
+    num_regions--;
+    mapped_bytes -= len;
+}
+
+/*
+ * mem_remap - resize the region at addr from old_len to new_len bytes, both
+ *   rounded up to MAP_PAGE, without copying its contents, like mremap with
+ *   MREMAP_MAYMOVE.  A region shrinks and grows in place while the gap above
+ *   it allows; otherwise its pages move to the highest gap that fits, which
+ *   renames pages in sparse mode and is a real mremap in dense mode.  Returns
+ *   the new address, or NULL with the region left as it was on failure.
+ */
+void *mem_remap(void *addr, size_t old_len, size_t new_len) {
+    unsigned char *lo = (unsigned char *) addr;
+    size_t l = find_region(lo);
+    old_len = (old_len + MAP_PAGE - 1) / MAP_PAGE * MAP_PAGE;
+    new_len = (new_len + MAP_PAGE - 1) / MAP_PAGE * MAP_PAGE;
+    if (l == num_regions || regions[l].lo != lo || regions[l].len != old_len) {
+        fprintf(stderr, "ERROR: mem_remap failed.  No region of %zu bytes at %p\n", old_len, addr);
+        return NULL;
+    }
+    if (new_len == 0)
+        return NULL;
+    unsigned char *above = l + 1 < num_regions ? regions[l+1].lo : mem_max_addr;
+    if (new_len <= old_len) {
+        if (sparse && new_len < old_len)
+            release_pages(lo + new_len, old_len - new_len);
+    } else if ((size_t) (above - lo) < new_len) {
+        /* The old region stays in the table, so the gap never overlaps it */
+        size_t i;
+        unsigned char *new_lo = find_gap(new_len, &i);
+        if (new_lo == NULL) {
+            fprintf(stderr, "ERROR: mem_remap failed.  No room for a region of %zu bytes\n", new_len);
+            errno = ENOMEM;
+            return NULL;
+        }
+        if (sparse) {
+            move_pages(lo, old_len, new_lo);
+        } else {
+            /* Move the pages, then plug the hole left in the heap mapping */
+            if (!move_mapping(lo, old_len, new_lo) ||
+                mmap(lo, old_len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+                fprintf(stderr, "FAILURE.  mremap couldn't move a region of %zu bytes\n", old_len);
+                exit(1);
+            }
+        }
+        /* Take the region out and put it back at its new place */
+        if (i > l) {
+            memmove(&regions[l], &regions[l+1], (i - l - 1) * sizeof(region_t));
+            i--;
+        } else {
+            memmove(&regions[i+1], &regions[i], (l - i) * sizeof(region_t));
+        }
+        regions[i].lo = new_lo;
+        l = i;
+        if (new_lo < fresh_hi)
+            fresh_hi = new_lo;
+    }
+    regions[l].len = new_len;
+    mapped_bytes = mapped_bytes - old_len + new_len;
+    update_peak();
+    return (void *) regions[l].lo;
+}
+
+/*
+ * mem_is_fresh - did the latest mem_sbrk or mem_map hand out [lo, hi] as memory
+ *   that had never been handed out before?  Such memory reads as zero, like the
+ *   fresh pages of a real sbrk or mmap; memory that has been given back and
+ *   handed out again keeps what was written to it.
+ */
+bool mem_is_fresh(const void *lo, const void *hi) {
+    return (unsigned char *) lo >= last_lo && (unsigned char *) hi < last_hi;
+}
+
+/*
+ * mem_is_mapped - is [lo, hi] inside a single region mapped by mem_map?
+ */
+bool mem_is_mapped(const void *lo, const void *hi) {
+    size_t l = 0, h = num_regions;
+    while (l < h) {
+        size_t m = (l + h) / 2;
+        if (regions[m].lo + regions[m].len <= (unsigned char *) lo)
+            l = m + 1;
+        else
+            h = m;
+    }
+    return l < num_regions && regions[l].lo <= (unsigned char *) lo &&
+        (unsigned char *) hi < regions[l].lo + regions[l].len;
+}
+
+/* Index of the first region that does not start below lo */
+static size_t find_region(const unsigned char *lo) {
+    size_t l = 0, h = num_regions;
+    while (l < h) {
+        size_t m = (l + h) / 2;
+        if (regions[m].lo < lo)
+            l = m + 1;
+        else
+            h = m;
+    }
+    return l;
+}
+
+/*
+ * Start of the highest gap between mem_brk and mem_max_addr that holds len
+ * bytes, or NULL.  *index is where a region placed there goes in the table.
+ */
+static unsigned char *find_gap(size_t len, size_t *index) {
+    unsigned char *hi = mem_max_addr;
+    size_t i = num_regions;
+    while (i > 0 && (size_t) (hi - (regions[i-1].lo + regions[i-1].len)) < len) {
+        hi = regions[i-1].lo;
+        i--;
+    }
+    if ((size_t) (hi - mem_brk) < len)
+        return NULL;
+    *index = i;
+    return hi - len;
+}
+
+/* Note the fresh part of [lo, hi), which is about to be handed out */
+static void hand_out(unsigned char *lo, unsigned char *hi) {
+    last_lo = lo > fresh_lo ? lo : fresh_lo;
+    last_hi = hi < fresh_hi ? hi : fresh_hi;
+}
+
+/* Record a new high water mark of heap plus mapped regions */
+static void update_peak(void) {
+    size_t size = (size_t) (mem_brk - heap) + mapped_bytes;
+    if (size > mem_peak_size)
+        mem_peak_size = size;
+}
+
 /*
  * mem_pagesize() - returns the page size of the system
  */
@@ -185,6 +452,22 @@ size_t mem_pagesize(){
     return (size_t) getpagesize();
 }
 
+/*
+ * mem_copy_bytes() - returns the number of bytes moved by mem_memcpy
+ *   since the heap was last reset
+ */
+size_t mem_copy_bytes(){
+    return copy_bytes;
+}
+
+/*
+ * mem_sbrk_calls() - returns the number of successful mem_sbrk calls
+ *   since the heap was last reset
+ */
+size_t mem_sbrk_calls(){
+    return sbrk_calls;
+}
+
 /*************** Memory emulation  *******************/
 
 __int128 mem_read128(const void* addr)
@@ -204,8 +487,7 @@ void mem_write128(void* addr, __int128 val)
 /* Read len bytes and return value zero-extended to 64 bits */
 uint64_t mem_read(const void *addr, size_t len) {
     uint64_t rdata;
-    if (sparse &&
-        (unsigned char *) addr >= heap && (unsigned char *) addr+len <= mem_brk) {
+    if (emulated(addr, len)) {
         /* Heap read.  Check if it crosses page boundary */
         size_t id = page_id(addr);
         void *paddr = get_mem(addr);
@@ -237,8 +519,7 @@ uint64_t mem_read(const void *addr, size_t len) {
 
 /* Write lower order len bytes of val to address */
 void mem_write(void *addr, uint64_t val, size_t len) {
-    if (sparse &&
-        (unsigned char *) addr >= heap && (unsigned char *) addr+len <= mem_brk) {
+    if (emulated(addr, len)) {
         /* Heap write.  Check to see if it crosses page boundary */
         size_t id = page_id(addr);
         void *paddr = get_mem(addr);
@@ -272,6 +553,7 @@ void mem_write(void *addr, uint64_t val, size_t len) {
 /* Emulation of memcpy */
 void *mem_memcpy(void *dst, const void *src, size_t n) {
     void *savedst = dst;
+    copy_bytes += n;
     size_t w = sizeof(uint64_t);
     while (n >= w) {
         uint64_t data = mem_read(src, w);
@@ -350,6 +632,29 @@ static void print_stats() {
     stats_printed = true;
 }
 
+/*
+ * mremap [lo, lo+len) to new_lo.  Kernels before 6.17 refuse a range that spans
+ * several mappings, which earlier moves can leave behind, so such a range is
+ * moved in halves.
+ */
+static bool move_mapping(unsigned char *lo, size_t len, unsigned char *new_lo) {
+    if (mremap(lo, len, len, MREMAP_MAYMOVE | MREMAP_FIXED, new_lo) != MAP_FAILED)
+        return true;
+    if (errno != EFAULT || len <= MAP_PAGE)
+        return false;
+    size_t half = len / 2 / MAP_PAGE * MAP_PAGE;
+    return move_mapping(lo, half, new_lo) &&
+        move_mapping(lo + half, len - half, new_lo + half);
+}
+
+/* Does sparse emulation back the len bytes at addr?  True for heap and regions */
+static bool emulated(const void *addr, size_t len) {
+    unsigned char *lo = (unsigned char *) addr;
+    if (!sparse || lo < heap)
+        return false;
+    return lo + len <= mem_brk || (num_regions > 0 && mem_is_mapped(lo, lo + len - 1));
+}
+
 /* Given an address, compute the ID  of its page */
 static size_t page_id(const void *addr) {
     size_t offset = (unsigned char *) addr - (unsigned char *) SPARSE_HEAP_START;
@@ -375,8 +680,15 @@ static void *get_mem(const void *addr) {
             fprintf(stderr, "FAILURE.  Ran out of memory for emulation\n");
             exit(1);
         }
-        block = next_free_page++;
+        if (released_pages) {
+            block = released_pages;
+            released_pages = block->next;
+        } else {
+            block = next_free_page++;
+        }
         num_free_pages--;
+        /* Untouched memory reads as zero, whichever page backs it */
+        memset(block->bytes, 0, SPARSE_PAGE_SIZE);
         block->id = id;
         block->next = page_table[b];
         page_table[b] = block;
@@ -386,3 +698,64 @@ static void *get_mem(const void *addr) {
     return (void *) &block->bytes[offset];
 }
 
+/* Give back the emulation pages that cover [lo, lo+len) */
+static void release_pages(unsigned char *lo, size_t len) {
+    size_t first = page_id(lo);
+    size_t last = page_id(lo + len - 1);
+    size_t b;
+    /* Regions are sparse, so walking the table beats probing every page ID */
+    for (b = 0; b < num_buckets; b++) {
+        mem_block_t **link = &page_table[b];
+        while (*link) {
+            mem_block_t *block = *link;
+            if (block->id >= first && block->id <= last) {
+                *link = block->next;
+                block->next = released_pages;
+                released_pages = block;
+                num_free_pages++;
+            } else {
+                link = &block->next;
+            }
+        }
+    }
+}
+
+/*
+ * Rename the emulation pages that cover [lo, lo+len) to cover the same
+ * offsets from new_lo.  Stale pages already covering the destination are
+ * given back first, so a lookup never finds them.
+ */
+static void move_pages(unsigned char *lo, size_t len, unsigned char *new_lo) {
+    size_t first = page_id(lo);
+    size_t last = page_id(lo + len - 1);
+    size_t new_first = page_id(new_lo);
+    size_t new_last = page_id(new_lo + len - 1);
+    mem_block_t *moved = NULL;
+    size_t b;
+    for (b = 0; b < num_buckets; b++) {
+        mem_block_t **link = &page_table[b];
+        while (*link) {
+            mem_block_t *block = *link;
+            if (block->id >= first && block->id <= last) {
+                *link = block->next;
+                block->next = moved;
+                moved = block;
+            } else if (block->id >= new_first && block->id <= new_last) {
+                *link = block->next;
+                block->next = released_pages;
+                released_pages = block;
+                num_free_pages++;
+            } else {
+                link = &block->next;
+            }
+        }
+    }
+    while (moved) {
+        mem_block_t *block = moved;
+        moved = block->next;
+        block->id = block->id - first + new_first;
+        b = block->id % num_buckets;
+        block->next = page_table[b];
+        page_table[b] = block;
+    }
+}
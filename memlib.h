@@ -9,8 +9,19 @@ void mem_reset_brk(void);
 void *mem_heap_lo(void);
 void *mem_heap_hi(void);
 size_t mem_heapsize(void);
+size_t mem_heap_peak(void);
 size_t mem_pagesize(void);
 
+/* Regions mapped outside the brk heap, page granular, committed lazily */
+void *mem_map(size_t len);
+void mem_unmap(void *addr, size_t len);
+void *mem_remap(void *addr, size_t old_len, size_t new_len);
+size_t mem_mapped_bytes(void);
+bool mem_is_mapped(const void *lo, const void *hi);
+
+/* Was [lo, hi] untouched when the latest mem_sbrk or mem_map handed it out? */
+bool mem_is_fresh(const void *lo, const void *hi);
+
 /* Functions used for memory emulation */
 
 /* Read len bytes and return value zero-extended to 64 bits */
@@ -24,6 +35,12 @@ void mem_write(void *addr, uint64_t val, size_t len);
 /* Emulation of memcpy */
 void *mem_memcpy(void *dst, const void *src, size_t n);
 
+/* Number of bytes moved by mem_memcpy since the heap was last reset */
+size_t mem_copy_bytes(void);
+
+/* Number of successful mem_sbrk calls since the heap was last reset */
+size_t mem_sbrk_calls(void);
+
 /* Emulation of memset */
 void *mem_memset(void *dst, int c, size_t n);
 
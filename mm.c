@@ -16,8 +16,47 @@
  * significant bit represents status of current block, the second least       *
  * significant bit represents status of previous block and the third least    *
  * significant bit represents whether previous block is 16 bytes.If block size* 
- * if 16 bytes, block will only keep header and next pointer,using third least* 
- * significant bit.                                                           *
+ * if 16 bytes, block will only keep header and two 32-bit links which are    *
+ * offsets from heap_start, using third least significant bit.                *
+ * Free list classes are computed with a bit scan, and a bitmap of non-empty  *
+ * lists lets find_fit jump straight to the closest larger non-empty list.    *
+ * Free blocks of chunksize or more are kept in a treap ordered by size and   *
+ * address instead of a list, so the best fit is found in O(log n).           *
+ * realloc grows a block in place when the next block is free or the block  *
+ * is the last one of the heap, and shrinks it in place by freeing its tail,  *
+ * instead of always copying it. The fourth least significant bit marks       *
+ * blocks realloc has grown before; they get 50% slack on further growth.     *
+ * realloc keeps a block that the new size fills at least half of, and        *
+ * malloc_usable_size reports the payload a block really has.                 *
+ * free_sized uses the size the caller asked for to skip the slab page lookup *
+ * for blocks too big to be slots.                                            *
+ * malloc_batch carves n blocks from one fit in a single pass, and free_batch *
+ * sorts its blocks by address and frees each run of neighbors as one block.  *
+ * Arenas bump allocate from chunks that are heap blocks,4KB growing to 64KB, *
+ * and mm_arena_reset frees all their objects with one free per chunk.        *
+ * malloc_hint keeps blocks of lifetime classes 1 to 3 apart from the heap,   *
+ * bumping them from 4KB chunks of their class that share the slab page map;  *
+ * a chunk is freed with its last object, so objects dying together leave no  *
+ * holes between the objects that live on.                                    *
+ * Freed blocks of up to 128 bytes wait in exact size LIFO fast bins and are *
+ * only coalesced when malloc finds no fit, before the heap is extended.      *
+ * Requests of up to 128 bytes are served from 4KB aligned slabs of slots of  *
+ * one size class, with no header per slot; free tells slots from blocks by *
+ * a bitmap of slab pages and finds the descriptor by masking the pointer.    *
+ * Empty slabs are freed, except the last one of a class, which waits for     *
+ * the same consolidation as the fast bins.                                   *
+ * When no fit is found, a free last block counts towards the heap extension, *
+ * and the increment adapts between 4KB and 1MB to how often heap is extended.*
+ * A free last block of 128KB or more is trimmed back to that increment with  *
+ * a negative mem_sbrk; mm_trim(pad) trims it down to pad bytes on request.   *
+ * Requests of 128KB or more that fit no free block get a page granular       *
+ * region of their own from mem_map, above the heap, instead of growing it;   *
+ * free unmaps the region at once and realloc resizes it with mem_remap,      *
+ * which moves pages instead of copying bytes.                                *
+ * memalign, aligned_alloc and posix_memalign search for a fit with room for  *
+ * the alignment and free the misaligned front of it as a block of its own.   *
+ * Building with -DTLSF=1 replaces the segregated lists by a two-level        *
+ * segregated fit index whose malloc and free take constant time.             *
  ******************************************************************************
  */
 #include <stdio.h>
@@ -29,6 +68,7 @@
 #include <stddef.h>
 #include <unistd.h>
 #include <inttypes.h>
+#include <errno.h>
 #include "mm.h"
 #include "memlib.h"
 /* Do not change the following! */
@@ -38,6 +78,14 @@
 #define free mm_free
 #define realloc mm_realloc
 #define calloc mm_calloc
+#define memalign mm_memalign
+#define aligned_alloc mm_aligned_alloc
+#define posix_memalign mm_posix_memalign
+#define malloc_usable_size mm_usable_size
+#define free_sized mm_free_sized
+#define malloc_batch mm_malloc_batch
+#define malloc_hint mm_malloc_hint
+#define free_batch mm_free_batch
 #define memset mem_memset
 #define memcpy mem_memcpy
 #endif /* def DRIVER */
@@ -66,6 +114,41 @@
 #define dbg_ensures(expr)   (sizeof(expr), 1)
 #define dbg_printheap(...)  ((void) sizeof(__VA_ARGS__))
 #endif
+/*
+ * TLSF selects the free block index at build time: 0 uses the segregated
+ * lists below, 1 uses two-level segregated fit lists with bitmaps.
+ */
+#ifndef TLSF
+#define TLSF 0
+#endif
+/*
+ * BEST_FIT_K bounds how many fitting blocks find_fit examines in a segregated
+ * list before it settles for the smallest of them; 1 gives plain first fit.
+ */
+#ifndef BEST_FIT_K
+#define BEST_FIT_K 8
+#endif
+/*
+ * FAST_BINS keeps freed small blocks in exact size bins without coalescing them.
+ * It is off by default with TLSF,whose malloc must not wait for a consolidation.
+ */
+#ifndef FAST_BINS
+#define FAST_BINS (!TLSF)
+#endif
+/*
+ * SLABS serves requests of up to SLAB_NUM * dsize bytes from slabs,pages cut into
+ * slots of one size that carry no header at all.
+ */
+#ifndef SLABS
+#define SLABS 1
+#endif
+/*
+ * BIG_THRESHOLD: requests of at least this many bytes which fit no free block get a
+ * region of their own from mem_map,outside the heap,unmapped as soon as they are freed.
+ */
+#ifndef BIG_THRESHOLD
+#define BIG_THRESHOLD (1 << 17)
+#endif
 /* Basic constants */
 typedef uint64_t word_t;
 // Word and header size (bytes)
@@ -74,9 +157,18 @@ static const size_t wsize = sizeof(word_t);
 static const size_t dsize = 2 * wsize;
 // Minimum block size (bytes)
 static const size_t min_block_size = dsize;
-// every time we need new heap space,we will add chunksize bytes space to our old heap
+// size of the first heap extension,and the initial grow_size
 // (Must be divisible by dsize)
 static const size_t chunksize = (1 << 14);
+//bounds of grow_size,the least size of the last block after heap is extended
+static const size_t grow_min = (1 << 12);
+static const size_t grow_max = (1 << 20);
+//heap extensions fewer than grow_often fits apart double grow_size,more than
+//grow_rarely fits apart halve it
+static const size_t grow_often = 16;
+static const size_t grow_rarely = 256;
+//a free last block of trim_threshold bytes or more is trimmed down to grow_size bytes
+static const size_t trim_threshold = (1 << 17);
 // using this mask to get least significant bit of header to find out block's status
 static const word_t alloc_mask = 0x1;
 //using this mask to get status of previous block
@@ -85,8 +177,34 @@ static const word_t prev_alloc_mask = 0x2;
 static const word_t size_mask = ~(word_t)0xF;
 //using this mask to find out whether size of previous block is dsize(16bytes)
 static const word_t dsize_mask = 0x4;
+//using this mask to mark an allocated block which realloc has already grown
+static const word_t grow_mask = 0x8;
 //num of free lists
 static const size_t NUM = 12;
+//largest 32-bit link of a 16 bytes free block, link 0 means NULL
+static const size_t mini_link_max = 0xFFFFFFFF;
+//num of fast bins,fast bin i holds freed blocks of (i+1)*dsize bytes
+static const size_t FAST_NUM = 8;
+//size of a slab block,slab payloads are aligned to it so a slot finds its slab by
+//masking,and slabs made one after another at the top of heap need no padding
+static const size_t slab_size = 1 << 12;
+//bytes at the start of a slab taken by its descriptor
+static const size_t slab_header = 64;
+//num of slab classes,class i holds slots of (i+1)*dsize bytes
+static const size_t SLAB_NUM = 8;
+//num of words in slot bitmap,enough for (slab_size - slab_header) / dsize slots
+static const size_t SLAB_MAP_WORDS = 4;
+//granularity of regions from mem_map
+static const size_t map_page = 1 << 12;
+//num of words in slab page bitmap,slabs are only made in the first 128MB of heap
+static const size_t SLAB_PAGE_WORDS = 512;
+//num of lifetime classes,class 0 is the main heap and the others have chunks of their own
+static const size_t LIFETIMES = MM_LIFETIMES;
+//largest request served from a lifetime chunk,so a chunk never wastes more than a quarter
+static const size_t life_max = 1 << 10;
+//bounds of the bytes an arena asks for its next chunk,which doubles each time
+static const size_t arena_chunk_min = 1 << 12;
+static const size_t arena_chunk_max = 1 << 16;
 /* Represents the header and payload of one block in the heap */
 typedef struct block
 {
@@ -98,14 +216,123 @@ typedef struct block
             struct block* next;
             struct block* prev;
         } st;
+        /* free blocks in list 0 are nodes of the large block treap */
+        struct {
+            struct block* left;
+            struct block* right;
+        } tr;
+        /* 16 bytes free blocks only have room for two 32-bit links */
+        struct {
+            uint32_t next;
+            uint32_t prev;
+        } mini;
         char payload[0];
     } u;
     
 } block_t;
+/* Descriptor at the start of every slab,slots follow it */
+typedef struct slab
+{
+    struct slab* next;
+    struct slab* prev;
+    //bit i is set when slot i is in use
+    word_t used_map[SLAB_MAP_WORDS];
+    //0 for a lifetime chunk,which bumps objects of any size instead of using slots
+    uint32_t slot_size;
+    //num of slots in use,or of live objects in a lifetime chunk
+    uint32_t used;
+    union {
+        struct {
+            //num of slots,slab_capacity() computed once
+            uint32_t capacity;
+            //2^32 / slot_size rounded up,turns the slot division of free into a multiply
+            uint32_t slot_recip;
+        };
+        struct {
+            //offset of the next payload of a lifetime chunk,and its class
+            uint32_t top;
+            uint32_t lifetime;
+        };
+    };
+} slab_t;
+/* Link at the start of every arena chunk,objects follow it */
+typedef struct arena_chunk
+{
+    struct arena_chunk* next;
+    //keeps the objects after the link dsize aligned
+    word_t pad;
+} arena_chunk_t;
+/* An arena bumps cur towards end in its current chunk */
+struct mm_arena
+{
+    arena_chunk_t* current;
+    //full chunks,and chunks of objects too big to share one
+    arena_chunk_t* retired;
+    char* cur;
+    char* end;
+    //bytes asked for the next chunk
+    size_t chunk_size;
+};
 //free list start block
 static block_t* root[NUM];
 //free list end block
 static block_t* leaf[NUM];
+//bit i is set when free list i is not empty
+static word_t list_map;
+//16 bytes free blocks too far from heap_start to be encoded in 32 bits
+static block_t* far_dsize_root;
+//root of the treap holding free blocks of list 0
+static block_t* tree_root;
+//fast bin heads,blocks in a fast bin still look allocated to the rest of heap
+static block_t* fast_bins[FAST_NUM];
+//bit i is set when fast bin i is not empty
+static word_t fast_map;
+//slabs of class i which still have a free slot
+static slab_t* slab_partial[SLAB_NUM];
+//slabs of class i which are full
+static slab_t* slab_full[SLAB_NUM];
+//num of slabs in heap,lifetime chunks included
+static size_t slab_count;
+//lifetime chunk each class bumps its objects from
+static slab_t* life_current[LIFETIMES];
+//num of lifetime chunks in heap
+static size_t life_count;
+//current heap increment,adapts to how often heap is extended
+static size_t grow_size;
+//num of fit searches so far,and its value at the last heap extension
+static size_t fit_count;
+static size_t grow_stamp;
+//bit i is set when page i counted from heap_start holds a slab,free looks a pointer
+//up here instead of reading its page,which would cost a cache miss for normal blocks
+static word_t slab_pages[SLAB_PAGE_WORDS];
+//bytes from heap_fresh to the epilogue have never been in an allocated block,they are
+//zero except for the header,links and footer of the free last block
+static char *heap_fresh;
+//set when heap grows into memory that is not fresh
+static bool heap_dirtied;
+#if TLSF
+/*
+ * Two-level segregated fit: first level list fl holds sizes in [2^(fl+7), 2^(fl+8)),
+ * split into tlsf_sl_num second level lists of equal width. Sizes below tlsf_small
+ * are all in first level 0, one second level list per dsize step.
+ */
+//log2 of number of second level lists
+static const size_t tlsf_sl_log = 4;
+//num of second level lists per first level list
+static const size_t tlsf_sl_num = 16;
+//log2 of tlsf_small
+static const int tlsf_small_log = 8;
+//blocks smaller than this size are indexed linearly
+static const size_t tlsf_small = 256;
+//num of first level lists, enough for any 64-bit size
+static const size_t tlsf_fl_num = 57;
+//bit fl is set when some second level list of fl is not empty
+static word_t tlsf_fl_map;
+//bit sl of tlsf_sl_map[fl] is set when tlsf_lists[fl][sl] is not empty
+static word_t tlsf_sl_map[tlsf_fl_num];
+//free list heads
+static block_t* tlsf_lists[tlsf_fl_num][tlsf_sl_num];
+#endif
 
 
 /* Global variables */
@@ -119,13 +346,60 @@ bool check_address_alignment(block_t* block);
 bool check_consistency(block_t* block);
 bool check_free_lists();
 bool check_dsize_free_lists();
+bool check_fast_bins();
+bool check_slabs();
+bool check_fresh();
 
 static block_t *extend_heap(size_t size);
+static block_t *grow_heap(size_t asize, size_t align);
+static block_t *find_top(void);
+static bool trim_heap(size_t pad);
+static void auto_trim(block_t *block);
 static block_t *find_fit(size_t asize);
 static block_t *find_dsize_fit(size_t asize);
+#if !TLSF
+static block_t *best_in_list(block_t* block, size_t asize);
+static block_t *tree_fit(size_t asize);
+#endif
 static block_t *coalesce_block(block_t *block);
 static void split_block(block_t *block, size_t asize);
+static bool grow_block(block_t *block, size_t asize);
+static void shrink_block(block_t *block, size_t asize);
+static void free_block(block_t *block);
+static void release_block(block_t *block);
+static bool consolidate_heap(void);
+static void place_block(block_t *block);
+static size_t carve_block(block_t *block, size_t asize, size_t n, void **out);
+static void sort_addresses(void **ptrs, size_t n);
+static void sift_address(void **ptrs, size_t i, size_t n);
+static block_t *alloc_aligned_block(size_t asize, size_t align);
+static size_t aligned_front(block_t *block, size_t align);
+static void note_growth(void *bp, size_t size);
+static void scrub(char *lo, char *hi);
+
+//manage slabs
+static void *slab_alloc(size_t index);
+static void slab_free(slab_t* slab, void *bp);
+static arena_chunk_t *arena_chunk(size_t size);
+static void arena_free_chunks(arena_chunk_t* chunk);
+static void *big_alloc(size_t size);
+static void big_free(void *bp);
+static void *big_remap(void *bp, size_t size);
+static bool is_big(void *bp);
+static slab_t *find_slab(void *bp);
+static slab_t *new_slab(size_t index);
+static size_t slab_capacity(slab_t* slab);
+static void slab_push(slab_t** list, slab_t* slab);
+static void slab_remove(slab_t** list, slab_t* slab);
+static void slab_release(slab_t* slab);
+static void *life_alloc(size_t lifetime, size_t size);
+static void life_free(slab_t* slab, void *bp);
+static slab_t *new_life_chunk(size_t lifetime);
+static void life_release(slab_t* slab);
+static size_t slot_usable(slab_t* slab, void *bp);
+static size_t slab_page(void *bp);
 static size_t max(size_t x, size_t y);
+static size_t min(size_t x, size_t y);
 
 static size_t extract_size(word_t header);
 static size_t get_size(block_t *block);
@@ -146,12 +420,26 @@ static word_t *find_prev_footer(block_t *block);
 static block_t *find_prev(block_t *block);
 
 //manage free lists
-static void initialize_list(block_t** root, block_t** leaf, block_t* block);
+static void initialize_list(block_t** root, block_t** leaf);
 static bool delete_block_from_list(block_t* block);
 static bool delete_dsize_free_block(block_t* block);
 static bool add_new_free_block(block_t* block);
 static bool add_dsize_free_block(block_t* block);
 static int find_free_list(size_t size);
+static bool mini_linkable(block_t* block);
+static uint32_t mini_encode(block_t* block);
+static block_t *mini_decode(uint32_t link);
+#if TLSF
+static void tlsf_mapping(size_t size, int* fl, int* sl);
+#else
+static bool tree_less(block_t* a, block_t* b);
+static word_t tree_priority(block_t* block);
+static void tree_split(block_t* tree, block_t* key, block_t** left, block_t** right);
+static block_t *tree_merge(block_t* left, block_t* right);
+static block_t *tree_insert(block_t* tree, block_t* block);
+static block_t *tree_remove(block_t* tree, block_t* block);
+static bool check_tree(block_t* tree, block_t* lo, block_t* hi);
+#endif
 
 static size_t my_round_up(size_t size,size_t n);
 static word_t my_pack(size_t size, bool prev_dsize_or_not, bool alloc_prev, bool alloc);
@@ -184,6 +472,10 @@ bool mm_init(void)
     
     // Heap starts with first "block header", currently the epilogue
     heap_start = (block_t *) &(start[1]);
+    heap_fresh = (char *) &(start[2]);
+    
+    //initialize free lists before the first free block is added
+    initialize_list(root, leaf);
     
     // Extend the empty heap with a free block of chunksize bytes
     block_t* block = extend_heap(chunksize);
@@ -191,10 +483,6 @@ bool mm_init(void)
     {
         return false;
     }
-    //initialize free lists
-    initialize_list(root, leaf, block);
-    block->u.st.prev = NULL;
-    block->u.st.next = NULL;
     return true;
 }
 /*
@@ -205,7 +493,6 @@ void *malloc(size_t size)
     dbg_requires(mm_checkheap(__LINE__));
     
     size_t asize;      // Adjusted block size
-    size_t extendsize; // Amount to extend heap if no fit is found
     block_t *block;
     void *bp = NULL;
     
@@ -220,50 +507,66 @@ void *malloc(size_t size)
         return bp;
     }
     
+    // Small requests get a slot of a slab when saving the header makes them smaller
+    if (SLABS && size <= SLAB_NUM * dsize && (size % dsize == 0 || size % dsize > wsize))
+    {
+        bp = slab_alloc((size + dsize - 1) / dsize - 1);
+        if (bp != NULL)
+        {
+            dbg_ensures(mm_checkheap(__LINE__));
+            return bp;
+        }
+    }
+    
     // Adjust block size to include overhead and to meet alignment requirements
     //asize = round_up(size + dsize, dsize);
     asize = my_round_up(size + wsize,dsize);
     
+    // A block from the fast bin of this size is ready to use,nothing to rewrite
+    if (FAST_BINS && asize <= FAST_NUM * dsize && fast_bins[asize / dsize - 1] != NULL)
+    {
+        size_t index = asize / dsize - 1;
+        block = fast_bins[index];
+        fast_bins[index] = block->u.st.next;
+        if (fast_bins[index] == NULL)
+        {
+            fast_map &= ~((word_t)1 << index);
+        }
+        bp = header_to_payload(block);
+        dbg_ensures(mm_checkheap(__LINE__));
+        return bp;
+    }
+    
     // Search the free list for a fit
+    fit_count++;
     block = find_fit(asize);
     
+    // Coalesce blocks held by fast bins and empty slabs before asking for more heap
+    if (block == NULL && consolidate_heap())
+    {
+        block = find_fit(asize);
+    }
+    
+    // Big requests that fit nowhere get a region of their own instead of more heap
+    if (block == NULL && size >= BIG_THRESHOLD)
+    {
+        bp = big_alloc(size);
+        dbg_ensures(mm_checkheap(__LINE__));
+        return bp;
+    }
+    
     // If no fit is found, request more memory, and then and place the block
     if (block == NULL)
     {
-        // Always request at least chunksize
-        extendsize = max(asize, chunksize);
-        block = extend_heap(extendsize);
+        block = grow_heap(asize, dsize);
         if (block == NULL) // extend_heap returns an error
         {
             return bp;
         }
         
     }
-    bool prev_alloc = (block->header) & prev_alloc_mask;
-    bool prev_dsize_or_not = (block->header) & dsize_mask;
-    
-    delete_block_from_list(block);
-    
-    // The block should be marked as free
-    dbg_assert(!get_alloc(block));
-    
     // Mark block as allocated
-    size_t block_size = get_size(block);
-    my_write_header(block, block_size, prev_dsize_or_not, prev_alloc, true);
-    //so far we have finished this current block
-    block_t* next_block = find_next(block);
-    bool next_alloc = get_alloc(next_block);
-    if(next_alloc){
-        next_block->header = (next_block->header) | prev_alloc_mask;
-    }
-    else{
-        next_block->header = (next_block->header) | prev_alloc_mask;
-        size_t next_size = get_size(next_block);
-        if(next_size != dsize){
-            word_t* footerp_next = header_to_footer(next_block);
-            *footerp_next = next_block->header;
-        }
-    }
+    place_block(block);
     
     // Try to split the block if too large
     split_block(block, asize);
@@ -286,41 +589,64 @@ void free(void *bp)
         return;
     }
     
-    block_t *block = payload_to_header(bp);
-    size_t size = get_size(block);
+    // A big block's region is unmapped at once
+    if (is_big(bp))
+    {
+        big_free(bp);
+        dbg_ensures(mm_checkheap(__LINE__));
+        return;
+    }
     
-    // The block should be marked as allocated
-    dbg_assert(get_alloc(block));
+    // A slot goes back to its slab
+    slab_t *slab = find_slab(bp);
+    if (slab != NULL)
+    {
+        slab_free(slab, bp);
+        dbg_ensures(mm_checkheap(__LINE__));
+        return;
+    }
     
-    bool prev_alloc = (block->header) & prev_alloc_mask;
-    bool prev_dsize_or_not = (block->header) & dsize_mask;
+    release_block(payload_to_header(bp));
     
-    // Mark the block as free
-    my_write_header(block, size, prev_dsize_or_not, prev_alloc, false);
-    if(size != dsize){
-        my_write_footer(block, size, prev_dsize_or_not, prev_alloc, false);
+    dbg_ensures(mm_checkheap(__LINE__));
+}
+/*
+ * free_sized: free bp,whose caller knows it asked for size bytes.slots only hold
+ * life_max bytes or less and realloc never keeps a larger request in one,so a
+ * bigger size spares the slab page lookup.
+ */
+void free_sized(void *bp, size_t size)
+{
+    dbg_requires(mm_checkheap(__LINE__));
+    
+    if (bp == NULL)
+    {
+        return;
     }
-    add_new_free_block(block);
-    //so far we have finished current block
-    //deal with next block
-    block_t* next_block = find_next(block);
-    bool next_alloc = get_alloc(next_block);
-    if(next_alloc){
-        next_block->header = (next_block->header) & (~prev_alloc_mask);
+    
+    // The block must have room for what the caller thinks it asked for
+    dbg_assert(size <= malloc_usable_size(bp));
+    
+    // A big block shrunk by realloc stays in its region,so always test for it
+    if (is_big(bp))
+    {
+        big_free(bp);
+        dbg_ensures(mm_checkheap(__LINE__));
+        return;
     }
-    else{
-        next_block->header = (next_block->header) & (~prev_alloc_mask);
-        size_t next_size = get_size(next_block);
-        if(next_size != dsize){
-            word_t* footerp_next = header_to_footer(next_block);
-            *footerp_next = (*footerp_next) & (~prev_alloc_mask);
-            *footerp_next = next_block->header;
+    
+    if (size <= life_max)
+    {
+        slab_t *slab = find_slab(bp);
+        if (slab != NULL)
+        {
+            slab_free(slab, bp);
+            dbg_ensures(mm_checkheap(__LINE__));
+            return;
         }
-        
     }
-
-    // Try to coalesce the block with its neighbors
-    block = coalesce_block(block);
+    
+    release_block(payload_to_header(bp));
     
     dbg_ensures(mm_checkheap(__LINE__));
 }
@@ -349,14 +675,128 @@ void *realloc(void *ptr, size_t size)
         return malloc(size);
     }
     
+    // A slot can only be kept if the new size still fits in it
+    slab_t *slab = find_slab(ptr);
+    if (slab != NULL)
+    {
+        size_t slot = slot_usable(slab, ptr);
+        if (size <= slot)
+        {
+            return ptr;
+        }
+        // An object of a lifetime chunk moves to a chunk of the same class
+        if (slab->slot_size == 0)
+        {
+            newptr = malloc_hint(size, slab->lifetime);
+        }
+        else
+        {
+            newptr = malloc(size);
+        }
+        if (newptr == NULL)
+        {
+            return NULL;
+        }
+        memcpy(newptr, ptr, slot);
+        slab_free(slab, ptr);
+        return newptr;
+    }
+    
+    size_t asize = my_round_up(size + wsize, dsize);
+    size_t block_size = get_size(block);
+    bool growing = (block->header) & grow_mask;
+    
+    /*
+     * a big block is kept while the new size is still big and fills at least half of
+     * its region,else its pages are remapped,which copies nothing.a block growing
+     * past BIG_THRESHOLD moves instead of growing heap.
+     */
+    bool big = is_big(ptr);
+    if (big || (size >= BIG_THRESHOLD && asize > block_size))
+    {
+        if (big && size >= BIG_THRESHOLD)
+        {
+            if (asize <= block_size && 2 * asize >= block_size)
+            {
+                return ptr;
+            }
+            newptr = big_remap(ptr, size);
+            if (newptr != NULL)
+            {
+                dbg_ensures(mm_checkheap(__LINE__));
+                return newptr;
+            }
+        }
+        newptr = malloc(size);
+        if (newptr == NULL)
+        {
+            return NULL;
+        }
+        copysize = get_payload_size(block);
+        if (size < copysize)
+        {
+            copysize = size;
+        }
+        memcpy(newptr, ptr, copysize);
+        free(ptr);
+        return newptr;
+    }
+    
+    /*
+     * a block the new size fits in is kept as it is while the request fills at least
+     * half of it,so callers that size themselves to mm_usable_size never move and a
+     * growing block keeps its slack.
+     */
+    if (asize <= block_size && 2 * asize >= block_size)
+    {
+        return ptr;
+    }
+    
+    // A smaller block is cut down where it is,the tail goes back to free lists
+    if (asize <= block_size)
+    {
+        shrink_block(block, asize);
+        block->header = (block->header) & (~grow_mask);
+        dbg_ensures(mm_checkheap(__LINE__));
+        return ptr;
+    }
+    
+    /*
+     * a block grown for the second time is probably a string or array being built,
+     * so give it half again as much as asked and the next few growths are free.
+     */
+    size_t gsize = asize;
+    if (growing)
+    {
+        gsize = my_round_up(asize + asize / 2, dsize);
+    }
+    
+    // Try to grow the block where it is before moving it
+    if (grow_block(block, gsize) || (gsize > asize && grow_block(block, asize)))
+    {
+        block->header = (block->header) | grow_mask;
+        dbg_ensures(mm_checkheap(__LINE__));
+        return ptr;
+    }
+    
     // Otherwise, proceed with reallocation
-    newptr = malloc(size);
+    newptr = malloc(gsize - wsize);
+    if (newptr == NULL && gsize > asize)
+    {
+        newptr = malloc(size);
+    }
     
     // If malloc fails, the original block is left untouched
     if (newptr == NULL)
     {
         return NULL;
     }
+    // Slots have no header to carry the mark
+    if (find_slab(newptr) == NULL)
+    {
+        block_t *new_block = payload_to_header(newptr);
+        new_block->header = (new_block->header) | grow_mask;
+    }
     
     // Copy the old data
     copysize = get_payload_size(block); // gets size of old payload
@@ -386,234 +826,1627 @@ void *calloc(size_t elements, size_t size)
         return NULL;
     }
     
+    if (heap_start == NULL)
+    {
+        mm_init();
+    }
+    char *fresh = heap_fresh;
+    heap_dirtied = false;
     bp = malloc(asize);
     if (bp == NULL)
     {
         return NULL;
     }
     
-    // Initialize all bits to 0
-    memset(bp, 0, asize);
+    // A region straight from mem_map is zero unless it has been mapped before
+    if (is_big(bp))
+    {
+        if (!mem_is_fresh(bp, (char *) bp + asize - 1))
+        {
+            memset(bp, 0, asize);
+        }
+        return bp;
+    }
+    
+    /*
+     * only the bytes below heap_fresh may hold old data.above it,a block carved from
+     * the free last block can still hold its links at the start and its footer at the
+     * end of the payload.
+     */
+    size_t dirty = min(asize, dsize);
+    if (heap_dirtied)
+    {
+        dirty = asize;
+    }
+    else if ((char *) bp < fresh)
+    {
+        dirty = max(dirty, min(asize, (size_t) (fresh - (char *) bp)));
+    }
+    memset(bp, 0, dirty);
+    char *footer = (char *) bp + get_payload_size(payload_to_header(bp)) - wsize;
+    if (footer >= (char *) bp + dirty && footer < (char *) bp + asize)
+    {
+        memset(footer, 0, min(wsize, (size_t) ((char *) bp + asize - footer)));
+    }
     
     return bp;
 }
-/******** The remaining content below are helper and debug routines ********/
 /*
- * extend_heap:extend heap size given argument size.
- * return value:pointer points to first block in extended part
+ * Allocates size bytes at a payload aligned to alignment,which must be a power of two.
+ * the misaligned front of the block found is split off and freed,so it coalesces
+ * with its neighbours instead of being wasted.returns NULL with errno set to EINVAL
+ * if alignment is not a power of two.
  */
-static block_t *extend_heap(size_t size)
+void *memalign(size_t alignment, size_t size)
 {
-    void *bp;
-    word_t* epi = (word_t*) (mem_heap_hi()-wsize + 1);
-    bool prev_alloc = (*epi) & prev_alloc_mask;
-    bool prev_dsize_or_not = (*epi) & dsize_mask;
+    dbg_requires(mm_checkheap(__LINE__));
     
-    // Allocate an even number of words to maintain alignment
-    size = my_round_up(size, dsize);
-    if ((bp = mem_sbrk(size)) == (void *)-1)
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
     {
+        errno = EINVAL;
         return NULL;
     }
     
-    /*
-     * bp represent payload of a block,so if we want to get block we need to find header
-     */
+    // Every payload is dsize aligned already
+    if (alignment <= dsize)
+    {
+        return malloc(size);
+    }
     
-    // Initialize free block header/footer
-    block_t *block = payload_to_header(bp);
-    my_write_header(block, size, prev_dsize_or_not, prev_alloc, false);
-    my_write_footer(block, size, prev_dsize_or_not, prev_alloc, false);
-    add_new_free_block(block);
+    if (heap_start == NULL)
+    {
+        mm_init();
+    }
     
-    // Create new epilogue header
-    block_t *block_next = find_next(block);
-
-    my_write_header(block_next, 0, false, false, true);
+    if (size == 0)
+    {
+        return NULL;
+    }
     
-    // Coalesce in case the previous block was free
-    block = coalesce_block(block);
+    // The search for a fit adds alignment to the block size
+    if (size > SIZE_MAX - alignment - dsize)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
     
-    return block;
+    // Slots start slab_header bytes into a page,slots of a multiple of alignment
+    // are all aligned
+    size_t ssize = (size + alignment - 1) & ~(alignment - 1);
+    if (SLABS && alignment <= slab_header && ssize <= SLAB_NUM * dsize)
+    {
+        void *bp = slab_alloc(ssize / dsize - 1);
+        if (bp != NULL)
+        {
+            dbg_ensures(mm_checkheap(__LINE__));
+            return bp;
+        }
+    }
+    
+    // Big regions put the payload at a fixed offset,so the rest comes from the heap
+    block_t *block = alloc_aligned_block(my_round_up(size + wsize, dsize), alignment);
+    if (block == NULL)
+    {
+        return NULL;
+    }
+    
+    dbg_ensures(mm_checkheap(__LINE__));
+    return header_to_payload(block);
 }
 /*
- * coalesce function will work if we have two continuous free blocks ,this might happen 
- * when we free an allocated block.The return value if a pointer points to coalesced 
- * block
- * This function will only be called when argument block is free.
+ * C11 aligned_alloc,which takes any size here,not only multiples of alignment
  */
-static block_t *coalesce_block(block_t *block)
+void *aligned_alloc(size_t alignment, size_t size)
 {
-    dbg_requires(!get_alloc(block));
+    return memalign(alignment, size);
+}
+/*
+ * POSIX posix_memalign:stores the payload in *memptr and returns 0,or returns EINVAL
+ * if alignment is not a power of two multiple of sizeof(void *),or ENOMEM.
+ * *memptr is left alone on failure.
+ */
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+    {
+        return EINVAL;
+    }
+    void *bp = memalign(alignment, size);
+    if (bp == NULL && size != 0)
+    {
+        return ENOMEM;
+    }
+    *memptr = bp;
+    return 0;
+}
+/*
+ * Returns the number of bytes that can be used at bp,which was returned by malloc,
+ * calloc,realloc or memalign and not yet freed.this is at least the size asked for,
+ * the rest comes from rounding and from splits too small to make.returns 0 for NULL.
+ */
+size_t malloc_usable_size(void *bp)
+{
+    if (bp == NULL)
+    {
+        return 0;
+    }
+    slab_t *slab = find_slab(bp);
+    if (slab != NULL)
+    {
+        return slot_usable(slab, bp);
+    }
+    // A big block reaches to the end of its region,like a heap block
+    return get_payload_size(payload_to_header(bp));
+}
+/*
+ * malloc_batch: allocate n blocks of size bytes each and store them in out.blocks of
+ * the heap are carved one after another from a fit for all of them,so the list
+ * search,unlink and split are done once per fit instead of once per block.
+ * return value:the number of blocks stored,less than n if heap cannot be extended.
+ */
+size_t malloc_batch(size_t size, size_t n, void **out)
+{
+    dbg_requires(mm_checkheap(__LINE__));
     
-    size_t size = get_size(block);
+    size_t count = 0;
     
-    /*
-     * we need to know status of next block and prev block
-     */
+    if (heap_start == NULL) // Initialize heap if it isn't initialized
+    {
+        mm_init();
+    }
     
-    block_t *block_next = find_next(block);
-    //block_t *block_prev = find_prev(block);
-    block_t *block_prev;
+    if (size == 0)
+    {
+        return 0;
+    }
     
-    //bool prev_alloc = extract_alloc(*find_prev_footer(block));
-    bool prev_alloc = (block->header) & prev_alloc_mask;
-    bool next_alloc = get_alloc(block_next);
-    bool prev_dsize_or_not = (block->header) & dsize_mask;
+    // Slots and big blocks are not carved,they go one by one
+    if (n == 1 || (SLABS && size <= SLAB_NUM * dsize && (size % dsize == 0 || size % dsize > wsize))
+        || size >= BIG_THRESHOLD)
+    {
+        while (count < n && (out[count] = malloc(size)) != NULL)
+        {
+            count++;
+        }
+        return count;
+    }
     
-    if (prev_alloc && next_alloc)              // Case 1
+    size_t asize = my_round_up(size + wsize, dsize);
+    if (n > SIZE_MAX / asize)
     {
-        // Nothing to do
+        return 0;
     }
     
-    else if (prev_alloc && !next_alloc)        // Case 2
+    // Blocks waiting in the fast bin of this size are ready to use
+    if (FAST_BINS && asize <= FAST_NUM * dsize)
     {
-        block_t* next_next_block = find_next(block_next);
-        next_next_block->header = next_next_block->header & (~dsize_mask);
-        //delete old free blocks
-        delete_block_from_list(block);
-        delete_block_from_list(block_next);
-        size += get_size(block_next);
-        bool temp = (block->header) & prev_alloc_mask;
-        //rewrite new size
-        my_write_header(block, size, prev_dsize_or_not, temp, false);
-        my_write_footer(block, size, prev_dsize_or_not, temp, false);
-        add_new_free_block(block);
+        size_t index = asize / dsize - 1;
+        while (count < n && fast_bins[index] != NULL)
+        {
+            out[count++] = header_to_payload(fast_bins[index]);
+            fast_bins[index] = fast_bins[index]->u.st.next;
+        }
+        if (fast_bins[index] == NULL)
+        {
+            fast_map &= ~((word_t)1 << index);
+        }
     }
     
-    else if (!prev_alloc && next_alloc)        // Case 3
+    while (count < n)
     {
-        block_next->header = block_next->header & (~dsize_mask);
-        if(prev_dsize_or_not){
-            block_prev = (block_t*) ((char *)block - dsize);
+        size_t want = (n - count) * asize;
+        fit_count++;
+        block_t *block = find_fit(want);
+        
+        // Without a fit for all of them,carve as many as the first fit holds
+        if (block == NULL)
+        {
+            block = find_fit(asize);
         }
-        else{
-            block_prev = find_prev(block);
+        if (block == NULL && consolidate_heap())
+        {
+            block = find_fit(asize);
         }
-        //delete old free blocks
-        delete_block_from_list(block);
-        delete_block_from_list(block_prev);
-        size += get_size(block_prev);
-        bool temp = (block_prev->header) & prev_alloc_mask;
-        bool tmp = (block_prev->header) & dsize_mask;
-        //rewrite new size
-        my_write_header(block_prev, size, tmp, temp, false);
-        my_write_footer(block_prev, size, tmp, temp, false);
-        block = block_prev;
-        add_new_free_block(block);
+        if (block == NULL)
+        {
+            block = grow_heap(want, dsize);
+            if (block == NULL)
+            {
+                break;
+            }
+        }
+        place_block(block);
+        count += carve_block(block, asize, n - count, out + count);
     }
     
-    else                                        // Case 4
+    dbg_ensures(mm_checkheap(__LINE__));
+    return count;
+}
+/*
+ * free_batch: free the n blocks of ptrs,which is reordered.heap blocks too big for
+ * fast bins are sorted by address and every run of neighbors is merged and freed as
+ * one block,so it is coalesced and put into free lists once.
+ */
+void free_batch(void **ptrs, size_t n)
+{
+    dbg_requires(mm_checkheap(__LINE__));
+    
+    size_t count = 0;
+    size_t i;
+    
+    // Big blocks,slots and blocks for fast bins go back one by one,as free does
+    for (i = 0; i < n; i++)
     {
-        block_t* next_next_block = find_next(block_next);
-        next_next_block->header = next_next_block->header & (~dsize_mask);
-        if(prev_dsize_or_not){
-            block_prev = (block_t*) ((char *)block - dsize);
+        void *bp = ptrs[i];
+        if (bp == NULL)
+        {
+            continue;
         }
-        else{
-            block_prev = find_prev(block);
+        if (is_big(bp))
+        {
+            big_free(bp);
+            continue;
         }
-        //delete old free blocks
-        delete_block_from_list(block_prev);
-        delete_block_from_list(block);
-        delete_block_from_list(block_next);
-        size += get_size(block_next) + get_size(block_prev);
-        bool temp = (block_prev->header) & prev_alloc_mask;
-        bool tmp = (block_prev->header) & dsize_mask;
-        //rewrite new size
-        my_write_header(block_prev, size, tmp, temp, false);
-        my_write_footer(block_prev, size, tmp, temp, false);
-        block = block_prev;
-        add_new_free_block(block);
+        slab_t *slab = find_slab(bp);
+        if (slab != NULL)
+        {
+            slab_free(slab, bp);
+            continue;
+        }
+        if (FAST_BINS && get_size(payload_to_header(bp)) <= FAST_NUM * dsize)
+        {
+            release_block(payload_to_header(bp));
+            continue;
+        }
+        ptrs[count++] = bp;
     }
+    sort_addresses(ptrs, count);
     
-    dbg_ensures(!get_alloc(block));
-    /* TODO: Can you write a postcondition about get_size(block)? */
+    i = 0;
+    while (i < count)
+    {
+        block_t *block = payload_to_header(ptrs[i]);
+        size_t size = get_size(block);
+        size_t j = i + 1;
+        while (j < count && payload_to_header(ptrs[j]) == (block_t *) ((char *) block + size))
+        {
+            size += get_size(payload_to_header(ptrs[j]));
+            j++;
+        }
+        if (j == i + 1)
+        {
+            free_block(block);
+        }
+        else
+        {
+            // The run becomes one allocated block,which is more than dsize bytes
+            bool prev_alloc = (block->header) & prev_alloc_mask;
+            bool prev_dsize_or_not = (block->header) & dsize_mask;
+            my_write_header(block, size, prev_dsize_or_not, prev_alloc, true);
+            block_t *next = find_next(block);
+            next->header = (next->header) & (~dsize_mask);
+            free_block(block);
+        }
+        i = j;
+    }
     
-    return block;
+    dbg_ensures(mm_checkheap(__LINE__));
 }
 /*
- * if we use a too large block then many bytes of this block are wasted,so we 
- * need to split this allocated block into an allocated block and a free block.
+ * malloc_hint: allocate size bytes for an object of the given lifetime class.class 0
+ * is the main heap,each other class bumps its objects too big for slots and of up to
+ * life_max bytes from lifetime chunks of its own,which are freed as soon as their last
+ * object is.objects that die together so leave no holes between objects that live on.
  */
-static void split_block(block_t *block, size_t asize)
+void *malloc_hint(size_t size, int lifetime)
 {
-    dbg_requires(get_alloc(block));
-    /* TODO: Can you write a precondition about the value of asize? */
+    dbg_requires(mm_checkheap(__LINE__));
     
-    size_t block_size = get_size(block);
-    bool prev_alloc = (block->header) & prev_alloc_mask;
-    bool prev_dsize_or_not = (block->header) & dsize_mask; 
+    if (heap_start == NULL) // Initialize heap if it isn't initialized
+    {
+        mm_init();
+    }
     
-    if ((block_size - asize) >= min_block_size)
+    // Slots are reused one by one already,so only blocks gain from a chunk
+    if (lifetime <= 0 || (size_t) lifetime >= LIFETIMES
+        || size <= SLAB_NUM * dsize || size > life_max)
     {
-        block_t *block_next;
-        bool block_dsize_or_not = false;
-        my_write_header(block, asize, prev_dsize_or_not, prev_alloc, true);
-        my_write_footer(block, asize, prev_dsize_or_not, prev_alloc, true);
-        
-        block_next = find_next(block);
-        if(get_size(block) == dsize){
-            block_dsize_or_not = true;
-        }
-        my_write_header(block_next, block_size - asize, block_dsize_or_not, true, false);
-        my_write_footer(block_next, block_size - asize, block_dsize_or_not, true, false);
-        add_new_free_block(block_next);
-        block_t* block_next_next = find_next(block_next);
-        bool next_next_alloc = get_alloc(block_next_next);
-        if(next_next_alloc){
-            block_next_next->header = (block_next_next->header) & (~prev_alloc_mask);
-            if((block_size - asize) == dsize){
-                block_next_next->header = block_next_next->header | dsize_mask;
-            }
+        return malloc(size);
+    }
+    
+    void *bp = life_alloc(lifetime, size);
+    if (bp == NULL)
+    {
+        // Beyond the reach of slab pages,the main heap still has room
+        return malloc(size);
+    }
+    
+    dbg_ensures(mm_checkheap(__LINE__));
+    return bp;
+}
+/*
+ * mm_arena_create: make an empty arena,whose descriptor is a heap block.
+ * return value:NULL if heap cannot be extended.
+ */
+mm_arena_t *mm_arena_create(void)
+{
+    if (heap_start == NULL) // Initialize heap if it isn't initialized
+    {
+        mm_init();
+    }
+    mm_arena_t *arena = malloc(sizeof(mm_arena_t));
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+    arena->current = NULL;
+    arena->retired = NULL;
+    arena->cur = NULL;
+    arena->end = NULL;
+    arena->chunk_size = arena_chunk_min;
+    
+    dbg_ensures(mm_checkheap(__LINE__));
+    return arena;
+}
+/*
+ * mm_arena_alloc: bump allocate size bytes from the current chunk of arena.a full
+ * chunk is retired for a new one,and objects of more than a quarter of a chunk get
+ * a chunk of their own,so a chunk never wastes more than a quarter of itself.
+ * return value:NULL if size is zero or heap cannot be extended.
+ */
+void *mm_arena_alloc(mm_arena_t *arena, size_t size)
+{
+    dbg_requires(mm_checkheap(__LINE__));
+    
+    if (size == 0 || size > SIZE_MAX - arena_chunk_max)
+    {
+        return NULL;
+    }
+    size = (size + dsize - 1) & ~(dsize - 1);
+    
+    if (size <= (size_t) (arena->end - arena->cur))
+    {
+        void *bp = arena->cur;
+        arena->cur += size;
+        return bp;
+    }
+    
+    if (size > arena->chunk_size / 4)
+    {
+        arena_chunk_t *chunk = arena_chunk(size);
+        if (chunk == NULL)
+        {
+            return NULL;
         }
-        else{
-            block_next_next->header = (block_next_next->header) & (~prev_alloc_mask);
-            if((block_size - asize) == dsize){
-                block_next_next->header = block_next_next->header | dsize_mask;
+        chunk->next = arena->retired;
+        arena->retired = chunk;
+        dbg_ensures(mm_checkheap(__LINE__));
+        return chunk + 1;
+    }
+    
+    arena_chunk_t *chunk = arena_chunk(arena->chunk_size);
+    if (chunk == NULL)
+    {
+        return NULL;
+    }
+    if (arena->current != NULL)
+    {
+        arena->current->next = arena->retired;
+        arena->retired = arena->current;
+    }
+    arena->current = chunk;
+    arena->cur = (char *) (chunk + 1) + size;
+    // Rounding may have left more room in the block than was asked for
+    arena->end = (char *) chunk + malloc_usable_size(chunk);
+    if (arena->chunk_size < arena_chunk_max)
+    {
+        arena->chunk_size *= 2;
+    }
+    
+    dbg_ensures(mm_checkheap(__LINE__));
+    return chunk + 1;
+}
+/*
+ * mm_arena_reset: free every object of arena at once.it costs a free per retired
+ * chunk instead of one per object,and the current chunk is kept for the objects
+ * to come.
+ */
+void mm_arena_reset(mm_arena_t *arena)
+{
+    dbg_requires(mm_checkheap(__LINE__));
+    
+    arena_free_chunks(arena->retired);
+    arena->retired = NULL;
+    if (arena->current != NULL)
+    {
+        arena->cur = (char *) (arena->current + 1);
+    }
+    
+    dbg_ensures(mm_checkheap(__LINE__));
+}
+/*
+ * mm_arena_destroy: free every object of arena,all its chunks and arena itself
+ */
+void mm_arena_destroy(mm_arena_t *arena)
+{
+    dbg_requires(mm_checkheap(__LINE__));
+    
+    if (arena == NULL)
+    {
+        return;
+    }
+    arena_free_chunks(arena->retired);
+    arena_free_chunks(arena->current);
+    free(arena);
+    
+    dbg_ensures(mm_checkheap(__LINE__));
+}
+/*
+ * mm_trim: consolidate the heap and give its free last block back to the system,
+ * except pad bytes of it.
+ * return value:true if heap has been shrunk
+ */
+bool mm_trim(size_t pad)
+{
+    dbg_requires(mm_checkheap(__LINE__));
+    
+    if (heap_start == NULL)
+    {
+        return false;
+    }
+    // Blocks in fast bins and empty slabs may still hide a free top
+    consolidate_heap();
+    bool trimmed = trim_heap(pad);
+    
+    dbg_ensures(mm_checkheap(__LINE__));
+    return trimmed;
+}
+/******** The remaining content below are helper and debug routines ********/
+/*
+ * extend_heap:extend heap size given argument size.
+ * return value:pointer points to first block in extended part
+ */
+static block_t *extend_heap(size_t size)
+{
+    void *bp;
+    word_t* epi = (word_t*) (mem_heap_hi()-wsize + 1);
+    bool prev_alloc = (*epi) & prev_alloc_mask;
+    bool prev_dsize_or_not = (*epi) & dsize_mask;
+    
+    // Allocate an even number of words to maintain alignment
+    size = my_round_up(size, dsize);
+    if ((bp = mem_sbrk(size)) == (void *)-1)
+    {
+        return NULL;
+    }
+    note_growth(bp, size);
+    
+    /*
+     * bp represent payload of a block,so if we want to get block we need to find header
+     */
+    
+    // Initialize free block header/footer
+    block_t *block = payload_to_header(bp);
+    my_write_header(block, size, prev_dsize_or_not, prev_alloc, false);
+    my_write_footer(block, size, prev_dsize_or_not, prev_alloc, false);
+    add_new_free_block(block);
+    
+    // Create new epilogue header
+    block_t *block_next = find_next(block);
+
+    my_write_header(block_next, 0, false, false, true);
+    
+    // Coalesce in case the previous block was free
+    block = coalesce_block(block);
+    
+    return block;
+}
+/*
+ * grow_heap: extend heap so that its last block is a free block holding asize bytes
+ * at a payload aligned to align.a free last block counts towards the extension,so
+ * heap only grows by the shortfall.small requests still make the last block at least
+ * grow_size bytes,which doubles while extensions come often and halves when they
+ * come rarely.
+ * return value:the last block,NULL if heap cannot be extended
+ */
+static block_t *grow_heap(size_t asize, size_t align)
+{
+    block_t *top = find_top();
+    size_t have = 0;
+    if (top != NULL)
+    {
+        have = get_size(top);
+    }
+    else
+    {
+        //the new block starts at the old epilogue when the last block is allocated
+        top = (block_t *) ((char *) mem_heap_hi() - wsize + 1);
+    }
+    size_t need = aligned_front(top, align) + asize;
+    if (have >= need)
+    {
+        return top;
+    }
+    size_t gap = fit_count - grow_stamp;
+    //the increment never exceeds an eighth of heap,so the slack it leaves stays small
+    if (gap < grow_often && grow_size < grow_max && grow_size * 8 < mem_heapsize())
+    {
+        grow_size *= 2;
+    }
+    else if (gap > grow_rarely && grow_size > grow_min)
+    {
+        grow_size /= 2;
+    }
+    grow_stamp = fit_count;
+    return extend_heap(max(need, grow_size) - have);
+}
+/*
+ * find_top: return the last block of heap if it is free,NULL otherwise
+ */
+static block_t *find_top(void)
+{
+    block_t *epi = (block_t *) ((char *) mem_heap_hi() - wsize + 1);
+    if (epi->header & prev_alloc_mask)
+    {
+        return NULL;
+    }
+    //16 bytes blocks have no footer,the epilogue tells their size
+    size_t size = (epi->header & dsize_mask) ? dsize : extract_size(*find_prev_footer(epi));
+    return (block_t *) ((char *) epi - size);
+}
+/*
+ * trim_heap: shrink heap so that at most pad bytes of its free last block are kept.
+ * return value:true if heap has been shrunk
+ */
+static bool trim_heap(size_t pad)
+{
+    block_t *top = find_top();
+    if (top == NULL)
+    {
+        return false;
+    }
+    size_t size = get_size(top);
+    size_t keep = my_round_up(pad, dsize);
+    if (keep >= size)
+    {
+        return false;
+    }
+    bool prev_alloc = (top->header) & prev_alloc_mask;
+    bool prev_dsize_or_not = (top->header) & dsize_mask;
+    delete_block_from_list(top);
+    if (mem_sbrk(-(intptr_t) (size - keep)) == (void *) -1)
+    {
+        add_new_free_block(top);
+        return false;
+    }
+    if (keep == 0)
+    {
+        //the last block is gone,its header becomes the epilogue
+        my_write_header(top, 0, prev_dsize_or_not, prev_alloc, true);
+        return true;
+    }
+    my_write_header(top, keep, prev_dsize_or_not, prev_alloc, false);
+    if (keep != dsize)
+    {
+        my_write_footer(top, keep, prev_dsize_or_not, prev_alloc, false);
+    }
+    add_new_free_block(top);
+    my_write_header(find_next(top), 0, keep == dsize, false, true);
+    return true;
+}
+/*
+ * auto_trim: trim policy,a free block which has become the last block of heap and has
+ * reached trim_threshold bytes is trimmed down to grow_size bytes,the amount the next
+ * extension would add anyway.
+ */
+static void auto_trim(block_t *block)
+{
+    if (get_size(block) >= trim_threshold && get_size(find_next(block)) == 0)
+    {
+        trim_heap(grow_size);
+    }
+}
+/*
+ * coalesce function will work if we have two continuous free blocks ,this might happen 
+ * when we free an allocated block.The return value if a pointer points to coalesced 
+ * block
+ * This function will only be called when argument block is free.
+ */
+static block_t *coalesce_block(block_t *block)
+{
+    dbg_requires(!get_alloc(block));
+    
+    size_t size = get_size(block);
+    
+    /*
+     * we need to know status of next block and prev block
+     */
+    
+    block_t *block_next = find_next(block);
+    //block_t *block_prev = find_prev(block);
+    block_t *block_prev;
+    
+    //bool prev_alloc = extract_alloc(*find_prev_footer(block));
+    bool prev_alloc = (block->header) & prev_alloc_mask;
+    bool next_alloc = get_alloc(block_next);
+    bool prev_dsize_or_not = (block->header) & dsize_mask;
+    
+    if (prev_alloc && next_alloc)              // Case 1
+    {
+        // Nothing to do
+    }
+    
+    else if (prev_alloc && !next_alloc)        // Case 2
+    {
+        block_t* next_next_block = find_next(block_next);
+        next_next_block->header = next_next_block->header & (~dsize_mask);
+        //delete old free blocks
+        delete_block_from_list(block);
+        delete_block_from_list(block_next);
+        size_t next_size = get_size(block_next);
+        size += next_size;
+        //the footer of block and the header and links of next are payload now
+        scrub((char *) block_next - wsize, (char *) block_next + min(next_size, wsize + dsize));
+        bool temp = (block->header) & prev_alloc_mask;
+        //rewrite new size
+        my_write_header(block, size, prev_dsize_or_not, temp, false);
+        my_write_footer(block, size, prev_dsize_or_not, temp, false);
+        add_new_free_block(block);
+    }
+    
+    else if (!prev_alloc && next_alloc)        // Case 3
+    {
+        block_next->header = block_next->header & (~dsize_mask);
+        if(prev_dsize_or_not){
+            block_prev = (block_t*) ((char *)block - dsize);
+        }
+        else{
+            block_prev = find_prev(block);
+        }
+        //delete old free blocks
+        delete_block_from_list(block);
+        delete_block_from_list(block_prev);
+        scrub((char *) block - wsize, (char *) block + min(size, wsize + dsize));
+        size += get_size(block_prev);
+        bool temp = (block_prev->header) & prev_alloc_mask;
+        bool tmp = (block_prev->header) & dsize_mask;
+        //rewrite new size
+        my_write_header(block_prev, size, tmp, temp, false);
+        my_write_footer(block_prev, size, tmp, temp, false);
+        block = block_prev;
+        add_new_free_block(block);
+    }
+    
+    else                                        // Case 4
+    {
+        block_t* next_next_block = find_next(block_next);
+        next_next_block->header = next_next_block->header & (~dsize_mask);
+        if(prev_dsize_or_not){
+            block_prev = (block_t*) ((char *)block - dsize);
+        }
+        else{
+            block_prev = find_prev(block);
+        }
+        //delete old free blocks
+        delete_block_from_list(block_prev);
+        delete_block_from_list(block);
+        delete_block_from_list(block_next);
+        size_t next_size = get_size(block_next);
+        scrub((char *) block - wsize, (char *) block + min(size, wsize + dsize));
+        scrub((char *) block_next - wsize, (char *) block_next + min(next_size, wsize + dsize));
+        size += next_size + get_size(block_prev);
+        bool temp = (block_prev->header) & prev_alloc_mask;
+        bool tmp = (block_prev->header) & dsize_mask;
+        //rewrite new size
+        my_write_header(block_prev, size, tmp, temp, false);
+        my_write_footer(block_prev, size, tmp, temp, false);
+        block = block_prev;
+        add_new_free_block(block);
+    }
+    
+    dbg_ensures(!get_alloc(block));
+    /* TODO: Can you write a postcondition about get_size(block)? */
+    
+    return block;
+}
+/*
+ * if we use a too large block then many bytes of this block are wasted,so we 
+ * need to split this allocated block into an allocated block and a free block.
+ */
+static void split_block(block_t *block, size_t asize)
+{
+    dbg_requires(get_alloc(block));
+    /* TODO: Can you write a precondition about the value of asize? */
+    
+    size_t block_size = get_size(block);
+    bool prev_alloc = (block->header) & prev_alloc_mask;
+    bool prev_dsize_or_not = (block->header) & dsize_mask; 
+    
+    if ((block_size - asize) >= min_block_size)
+    {
+        block_t *block_next;
+        bool block_dsize_or_not = false;
+        //allocated blocks have no footer,writing one would clobber the payload
+        my_write_header(block, asize, prev_dsize_or_not, prev_alloc, true);
+        
+        block_next = find_next(block);
+        if(get_size(block) == dsize){
+            block_dsize_or_not = true;
+        }
+        my_write_header(block_next, block_size - asize, block_dsize_or_not, true, false);
+        my_write_footer(block_next, block_size - asize, block_dsize_or_not, true, false);
+        add_new_free_block(block_next);
+        block_t* block_next_next = find_next(block_next);
+        bool next_next_alloc = get_alloc(block_next_next);
+        if(next_next_alloc){
+            block_next_next->header = (block_next_next->header) & (~prev_alloc_mask);
+            if((block_size - asize) == dsize){
+                block_next_next->header = block_next_next->header | dsize_mask;
+            }
+        }
+        else{
+            block_next_next->header = (block_next_next->header) & (~prev_alloc_mask);
+            if((block_size - asize) == dsize){
+                block_next_next->header = block_next_next->header | dsize_mask;
+            }
+            if(get_size(block_next_next) != dsize){
+                word_t* footerp_next_next = header_to_footer(block_next_next);
+                *footerp_next_next = block_next_next->header;
+            }
+        }
+    }
+    
+    //an allocated block is never fresh again
+    char *end = (char *) find_next(block);
+    if(end > heap_fresh){
+        heap_fresh = end;
+    }
+    
+    dbg_ensures(get_alloc(block));
+}
+/*
+ * grow_block: make allocated block at least asize bytes without moving it,by absorbing
+ * the next block if it is free and by extending the heap if block(or the free block
+ * after it) is the last block before epilogue.
+ * return value is true if block has been grown,otherwise block is left untouched.
+ */
+static bool grow_block(block_t *block, size_t asize)
+{
+    dbg_requires(get_alloc(block));
+    
+    size_t size = get_size(block);
+    bool prev_alloc = (block->header) & prev_alloc_mask;
+    bool prev_dsize_or_not = (block->header) & dsize_mask;
+    block_t *block_next = find_next(block);
+    bool next_alloc = get_alloc(block_next);
+    size_t avail = size;
+    if(!next_alloc){
+        avail += get_size(block_next);
+    }
+    
+    char *old_brk = NULL;
+    if(avail < asize){
+        //only the last block of heap can get more space from mem_sbrk
+        block_t *block_last = next_alloc ? block_next : find_next(block_next);
+        if(get_size(block_last) != 0){
+            return false;
+        }
+        if((old_brk = mem_sbrk(asize - avail)) == (void *)-1){
+            return false;
+        }
+        note_growth(old_brk, asize - avail);
+        avail = asize;
+    }
+    
+    if(!next_alloc){
+        delete_block_from_list(block_next);
+        scrub((char *) block_next, (char *) block_next + min(get_size(block_next), wsize + dsize));
+    }
+    if(old_brk != NULL){
+        //old footer of the next block and old epilogue
+        scrub(old_brk - dsize, old_brk);
+    }
+    my_write_header(block, avail, prev_dsize_or_not, prev_alloc, true);
+    
+    //block after the grown block is either allocated or a new epilogue
+    block_next = find_next(block);
+    if(block_next == (block_t *) (mem_heap_hi() - wsize + 1)){
+        my_write_header(block_next, 0, false, true, true);
+    }
+    else{
+        block_next->header = ((block_next->header) | prev_alloc_mask) & (~dsize_mask);
+    }
+    
+    // Give back what we do not need
+    split_block(block, asize);
+    
+    dbg_ensures(get_alloc(block));
+    return true;
+}
+/*
+ * shrink_block: cut allocated block down to asize bytes without moving it.the tail is
+ * split off and coalesced with the next block if that one is free.
+ */
+static void shrink_block(block_t *block, size_t asize)
+{
+    dbg_requires(get_alloc(block));
+    
+    size_t size = get_size(block);
+    split_block(block, asize);
+    if(get_size(block) < size){
+        auto_trim(coalesce_block(find_next(block)));
+    }
+    
+    dbg_ensures(get_alloc(block));
+}
+/*
+ * release_block: give back allocated heap block.small blocks wait in fast bins and are
+ * coalesced later all at once,the others are freed and coalesced now.
+ */
+static void release_block(block_t *block)
+{
+    size_t size = get_size(block);
+    
+    // The block should be marked as allocated
+    dbg_assert(get_alloc(block));
+    
+    if (FAST_BINS && size <= FAST_NUM * dsize)
+    {
+        size_t index = size / dsize - 1;
+        block->header = (block->header) & (~grow_mask);
+        block->u.st.next = fast_bins[index];
+        fast_bins[index] = block;
+        fast_map |= (word_t)1 << index;
+        return;
+    }
+    
+    free_block(block);
+}
+/*
+ * free_block: mark allocated block as free,put it into free lists and coalesce it
+ * with its neighbors.
+ */
+static void free_block(block_t *block)
+{
+    dbg_requires(get_alloc(block));
+    
+    size_t size = get_size(block);
+    bool prev_alloc = (block->header) & prev_alloc_mask;
+    bool prev_dsize_or_not = (block->header) & dsize_mask;
+    
+    // Mark the block as free
+    my_write_header(block, size, prev_dsize_or_not, prev_alloc, false);
+    if(size != dsize){
+        my_write_footer(block, size, prev_dsize_or_not, prev_alloc, false);
+    }
+    add_new_free_block(block);
+    //so far we have finished current block
+    //deal with next block
+    block_t* next_block = find_next(block);
+    bool next_alloc = get_alloc(next_block);
+    if(next_alloc){
+        next_block->header = (next_block->header) & (~prev_alloc_mask);
+    }
+    else{
+        next_block->header = (next_block->header) & (~prev_alloc_mask);
+        size_t next_size = get_size(next_block);
+        if(next_size != dsize){
+            word_t* footerp_next = header_to_footer(next_block);
+            *footerp_next = (*footerp_next) & (~prev_alloc_mask);
+            *footerp_next = next_block->header;
+        }
+        
+    }
+
+    // Try to coalesce the block with its neighbors
+    auto_trim(coalesce_block(block));
+}
+/*
+ * consolidate_heap: free every block held by fast bins and every empty slab or lifetime
+ * chunk for real,so that they can be coalesced with their neighbors and used for larger
+ * requests.
+ * return value is true if any block has been freed.
+ */
+static bool consolidate_heap(void)
+{
+    bool freed = (fast_map != 0);
+    size_t index;
+    //an empty slab is only kept while it is the only slab of its class
+    for(index = 0; index < SLAB_NUM; index++){
+        slab_t* slab = slab_partial[index];
+        if(slab != NULL && slab->used == 0){
+            slab_release(slab);
+            freed = true;
+        }
+    }
+    //so is an empty lifetime chunk while it is the current chunk of its class
+    for(index = 1; index < LIFETIMES; index++){
+        slab_t* slab = life_current[index];
+        if(slab != NULL && slab->used == 0){
+            life_current[index] = NULL;
+            life_release(slab);
+            freed = true;
+        }
+    }
+    for(index = 0; index < FAST_NUM; index++){
+        block_t* block = fast_bins[index];
+        while(block != NULL){
+            block_t* next = block->u.st.next;
+            free_block(block);
+            block = next;
+        }
+        fast_bins[index] = NULL;
+    }
+    fast_map = 0;
+    return freed;
+}
+/*
+ * place_block: take free block out of free lists and mark it as allocated
+ */
+static void place_block(block_t *block)
+{
+    bool prev_alloc = (block->header) & prev_alloc_mask;
+    bool prev_dsize_or_not = (block->header) & dsize_mask;
+    
+    delete_block_from_list(block);
+    
+    // The block should be marked as free
+    dbg_assert(!get_alloc(block));
+    
+    // Mark block as allocated
+    size_t block_size = get_size(block);
+    my_write_header(block, block_size, prev_dsize_or_not, prev_alloc, true);
+    //so far we have finished this current block
+    block_t* next_block = find_next(block);
+    bool next_alloc = get_alloc(next_block);
+    if(next_alloc){
+        next_block->header = (next_block->header) | prev_alloc_mask;
+    }
+    else{
+        next_block->header = (next_block->header) | prev_alloc_mask;
+        size_t next_size = get_size(next_block);
+        if(next_size != dsize){
+            word_t* footerp_next = header_to_footer(next_block);
+            *footerp_next = next_block->header;
+        }
+    }
+}
+/*
+ * carve_block: split allocated block into as many blocks of asize bytes as it holds,
+ * up to n,and store their payloads in out.the last one keeps the rest of block,which
+ * is split off as a free block when it is big enough.
+ * return value:the number of blocks stored,at least 1 as block holds asize bytes.
+ */
+static size_t carve_block(block_t *block, size_t asize, size_t n, void **out)
+{
+    dbg_requires(get_alloc(block));
+    dbg_requires(get_size(block) >= asize);
+    
+    size_t count = min(n, get_size(block) / asize);
+    size_t rest = get_size(block) - (count - 1) * asize;
+    bool prev_alloc = (block->header) & prev_alloc_mask;
+    bool prev_dsize_or_not = (block->header) & dsize_mask;
+    size_t i;
+    
+    for (i = 0; i + 1 < count; i++)
+    {
+        my_write_header(block, asize, prev_dsize_or_not, prev_alloc, true);
+        out[i] = header_to_payload(block);
+        block = find_next(block);
+        prev_alloc = true;
+        prev_dsize_or_not = (asize == dsize);
+    }
+    my_write_header(block, rest, prev_dsize_or_not, prev_alloc, true);
+    
+    //the block after the last one may now follow a 16 bytes block
+    if (rest == dsize)
+    {
+        block_t *next = find_next(block);
+        next->header = (next->header) | dsize_mask;
+        if (!get_alloc(next) && get_size(next) != dsize)
+        {
+            *header_to_footer(next) = next->header;
+        }
+    }
+    split_block(block, asize);
+    out[count - 1] = header_to_payload(block);
+    
+    dbg_ensures(get_alloc(block));
+    return count;
+}
+/*
+ * sort_addresses: sort n pointers into ascending address order with a heap sort,
+ * which needs no memory from malloc.
+ */
+static void sort_addresses(void **ptrs, size_t n)
+{
+    size_t end;
+    size_t i;
+    
+    // Build a max heap of the addresses,then move the largest behind it each time
+    for (i = n / 2; i > 0; i--)
+    {
+        sift_address(ptrs, i - 1, n);
+    }
+    for (end = n; end > 1; end--)
+    {
+        void *top = ptrs[0];
+        ptrs[0] = ptrs[end - 1];
+        ptrs[end - 1] = top;
+        sift_address(ptrs, 0, end - 1);
+    }
+}
+/*
+ * sift_address: move ptrs[i] down the max heap of the first n pointers until both
+ * children are lower addresses.
+ */
+static void sift_address(void **ptrs, size_t i, size_t n)
+{
+    while (2 * i + 1 < n)
+    {
+        size_t child = 2 * i + 1;
+        if (child + 1 < n && (char *) ptrs[child + 1] > (char *) ptrs[child])
+        {
+            child++;
+        }
+        if ((char *) ptrs[i] >= (char *) ptrs[child])
+        {
+            return;
+        }
+        void *tmp = ptrs[i];
+        ptrs[i] = ptrs[child];
+        ptrs[child] = tmp;
+        i = child;
+    }
+}
+/*
+ * alloc_aligned_block: allocate a block of asize bytes whose payload is aligned to align,
+ * which must be a power of two.the misaligned front of the fit is freed again.
+ * return value is NULL if heap cannot be extended.
+ */
+static block_t *alloc_aligned_block(size_t asize, size_t align)
+{
+    //a fit of asize bytes may be aligned already,any fit of asize + align bytes holds
+    //an aligned payload followed by asize bytes
+    size_t search = asize + align;
+    fit_count++;
+    block_t *block = find_fit(asize);
+    if (block != NULL && aligned_front(block, align) + asize > get_size(block))
+    {
+        block = find_fit(search);
+    }
+    if (block == NULL && consolidate_heap())
+    {
+        block = find_fit(search);
+    }
+    if (block == NULL)
+    {
+        block = grow_heap(asize, align);
+        if (block == NULL)
+        {
+            return NULL;
+        }
+    }
+    place_block(block);
+    
+    //payloads are dsize aligned,so the front is either empty or a valid block
+    size_t front = aligned_front(block, align);
+    if (front != 0)
+    {
+        size_t size = get_size(block);
+        bool prev_alloc = (block->header) & prev_alloc_mask;
+        bool prev_dsize_or_not = (block->header) & dsize_mask;
+        block_t *aligned = (block_t *) ((char *) block + front);
+        my_write_header(block, front, prev_dsize_or_not, prev_alloc, true);
+        my_write_header(aligned, size - front, front == dsize, true, true);
+        free_block(block);
+        block = aligned;
+    }
+    
+    split_block(block, asize);
+    return block;
+}
+/*
+ * aligned_front: num of bytes between block and the first block inside it whose payload
+ * is aligned to align
+ */
+static size_t aligned_front(block_t *block, size_t align)
+{
+    size_t payload = (size_t) header_to_payload(block);
+    return my_round_up(payload, align) - payload;
+}
+/*
+ * note_growth: heap has grown by size bytes at bp.they are only known to be zero if
+ * mem_sbrk handed them out fresh,otherwise none of the heap is fresh any more.
+ */
+static void note_growth(void *bp, size_t size)
+{
+    char *brk = (char *) bp + size;
+    if (!mem_is_fresh(bp, brk - 1))
+    {
+        heap_dirtied = true;
+        if (brk > heap_fresh)
+        {
+            heap_fresh = brk;
+        }
+    }
+}
+/*
+ * scrub: zero the part of [lo,hi) above heap_fresh,where merging two free blocks has
+ * left a header,links or a footer inside the payload of the merged block
+ */
+static void scrub(char *lo, char *hi)
+{
+    if (lo < heap_fresh)
+    {
+        lo = heap_fresh;
+    }
+    if (lo < hi)
+    {
+        memset(lo, 0, hi - lo);
+    }
+}
+/*
+ * slab_alloc: return a free slot of slab class index,a new slab is made if all slabs of
+ * this class are full.return value is NULL if heap cannot be extended.
+ */
+static void *slab_alloc(size_t index)
+{
+    slab_t *slab = slab_partial[index];
+    if(slab == NULL){
+        slab = new_slab(index);
+        if(slab == NULL){
+            return NULL;
+        }
+    }
+    size_t word;
+    for(word = 0; ~(slab->used_map[word]) == 0; word++);
+    size_t slot = word * 64 + __builtin_ctzll(~(slab->used_map[word]));
+    slab->used_map[word] |= (word_t)1 << (slot % 64);
+    slab->used++;
+    if(slab->used == slab->capacity){
+        slab_remove(&slab_partial[index], slab);
+        slab_push(&slab_full[index], slab);
+    }
+    return (char *) slab + slab_header + slot * slab->slot_size;
+}
+/*
+ * slab_free: give slot bp back to slab.a slab which becomes empty is freed,unless it is
+ * the only slab of its class with free slots.
+ */
+static void slab_free(slab_t* slab, void *bp)
+{
+    if(slab->slot_size == 0){
+        life_free(slab, bp);
+        return;
+    }
+    size_t index = slab->slot_size / dsize - 1;
+    size_t slot = (((char *) bp - (char *) slab - slab_header) * (uint64_t) slab->slot_recip) >> 32;
+    if(slab->used == slab->capacity){
+        slab_remove(&slab_full[index], slab);
+        slab_push(&slab_partial[index], slab);
+    }
+    slab->used_map[slot / 64] &= ~((word_t)1 << (slot % 64));
+    slab->used--;
+    if(slab->used == 0 && (slab->next != NULL || slab->prev != NULL)){
+        slab_release(slab);
+    }
+}
+/*
+ * arena_chunk: allocate a chunk with room for size bytes of objects after its link.
+ * return value:NULL if heap cannot be extended.
+ */
+static arena_chunk_t *arena_chunk(size_t size)
+{
+    arena_chunk_t *chunk = malloc(sizeof(arena_chunk_t) + size);
+    if (chunk != NULL)
+    {
+        chunk->next = NULL;
+    }
+    return chunk;
+}
+/*
+ * arena_free_chunks: free chunk and every chunk linked after it
+ */
+static void arena_free_chunks(arena_chunk_t* chunk)
+{
+    while (chunk != NULL)
+    {
+        arena_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
+/*
+ * big_alloc: map a region for a block of size payload bytes.the first word of the
+ * region pads the payload to dsize alignment,the block header follows and holds
+ * the region size minus that padding,so free knows how much to unmap.
+ * return value is NULL if no region can be mapped.
+ */
+static void *big_alloc(size_t size)
+{
+    size_t len = my_round_up(size + dsize + wsize, map_page);
+    if (len < size)
+    {
+        return NULL;
+    }
+    word_t *region = (word_t *) mem_map(len);
+    if (region == NULL)
+    {
+        return NULL;
+    }
+    block_t *block = (block_t *) (region + 1);
+    my_write_header(block, len - dsize, false, true, true);
+    return header_to_payload(block);
+}
+/*
+ * big_free: unmap the region of big block bp
+ */
+static void big_free(void *bp)
+{
+    block_t *block = payload_to_header(bp);
+    mem_unmap((char *) block - wsize, get_size(block) + dsize);
+}
+/*
+ * big_remap: resize the region of big block bp to hold size payload bytes with
+ * mem_remap,in place or by moving its pages.return value is the new payload,or NULL
+ * if the region can not be remapped,in which case bp is untouched.
+ */
+static void *big_remap(void *bp, size_t size)
+{
+    block_t *block = payload_to_header(bp);
+    size_t len = my_round_up(size + dsize + wsize, map_page);
+    if (len < size)
+    {
+        return NULL;
+    }
+    word_t *region = (word_t *) mem_remap((char *) block - wsize, get_size(block) + dsize, len);
+    if (region == NULL)
+    {
+        return NULL;
+    }
+    block = (block_t *) (region + 1);
+    my_write_header(block, len - dsize, false, true, true);
+    return header_to_payload(block);
+}
+/*
+ * is_big: regions are mapped above the heap,so any payload above it is a big block
+ */
+static bool is_big(void *bp)
+{
+    return (char *) bp > (char *) mem_heap_hi();
+}
+/*
+ * find_slab: return the slab that bp is a slot of,or NULL if bp is the payload of a
+ * normal block.a slab block covers its whole page,so a normal payload is never in a
+ * page marked in slab_pages.
+ */
+static slab_t *find_slab(void *bp)
+{
+    if(slab_count == 0){
+        return NULL;
+    }
+    size_t page = slab_page(bp);
+    if(page >= SLAB_PAGE_WORDS * 64 || !(slab_pages[page / 64] & ((word_t)1 << (page % 64)))){
+        return NULL;
+    }
+    return (slab_t *) ((size_t) bp & ~(slab_size - 1));
+}
+/*
+ * slab_page: index of the page holding bp,counted from the page of heap_start
+ */
+static size_t slab_page(void *bp)
+{
+    return (size_t) bp / slab_size - (size_t) heap_start / slab_size;
+}
+/*
+ * new_slab: carve a slab for class index out of an aligned block and put it into the
+ * list of slabs with free slots
+ */
+static slab_t *new_slab(size_t index)
+{
+    block_t *block = alloc_aligned_block(slab_size, slab_size);
+    if(block == NULL){
+        return NULL;
+    }
+    slab_t *slab = (slab_t *) header_to_payload(block);
+    size_t page = slab_page(slab);
+    if(page >= SLAB_PAGE_WORDS * 64){
+        //out of reach of slab_pages,the request is served by a normal block
+        free_block(block);
+        return NULL;
+    }
+    slab_pages[page / 64] |= (word_t)1 << (page % 64);
+    size_t word;
+    for(word = 0; word < SLAB_MAP_WORDS; word++){
+        slab->used_map[word] = 0;
+    }
+    slab->slot_size = (index + 1) * dsize;
+    slab->used = 0;
+    slab->capacity = slab_capacity(slab);
+    slab->slot_recip = (uint32_t) (((uint64_t) 1 << 32) / slab->slot_size + 1);
+    //slots past the capacity are marked used so they are never handed out
+    size_t slot;
+    for(slot = slab->capacity; slot < SLAB_MAP_WORDS * 64; slot++){
+        slab->used_map[slot / 64] |= (word_t)1 << (slot % 64);
+    }
+    slab_push(&slab_partial[index], slab);
+    slab_count++;
+    return slab;
+}
+/*
+ * slab_capacity: num of slots in slab
+ */
+static size_t slab_capacity(slab_t* slab)
+{
+    //the last word of a slab is the header of next block
+    return (slab_size - wsize - slab_header) / slab->slot_size;
+}
+/*
+ * slab_push: add slab to the front of a slab list
+ */
+static void slab_push(slab_t** list, slab_t* slab)
+{
+    slab->prev = NULL;
+    slab->next = *list;
+    if(*list != NULL){
+        (*list)->prev = slab;
+    }
+    *list = slab;
+}
+/*
+ * slab_remove: unlink slab from a slab list
+ */
+static void slab_remove(slab_t** list, slab_t* slab)
+{
+    if(slab->prev != NULL){
+        slab->prev->next = slab->next;
+    }
+    else{
+        *list = slab->next;
+    }
+    if(slab->next != NULL){
+        slab->next->prev = slab->prev;
+    }
+}
+/*
+ * slab_release: take an empty slab out of its partial list and free its block
+ */
+static void slab_release(slab_t* slab)
+{
+    size_t index = slab->slot_size / dsize - 1;
+    size_t page = slab_page(slab);
+    slab_remove(&slab_partial[index], slab);
+    slab_pages[page / 64] &= ~((word_t)1 << (page % 64));
+    slab_count--;
+    free_block(payload_to_header(slab));
+}
+/*
+ * life_alloc: bump an object of size bytes from the current chunk of lifetime class.
+ * the word before the object holds its size,like the header of a block.a full chunk
+ * is left to its objects and freed with the last of them.
+ * return value:NULL if no chunk can be made.
+ */
+static void *life_alloc(size_t lifetime, size_t size)
+{
+    size_t asize = my_round_up(size + wsize, dsize);
+    slab_t *slab = life_current[lifetime];
+    
+    //the last word of a chunk is the header of next block
+    if(slab == NULL || slab->top + asize > slab_size){
+        if(slab != NULL && slab->used == 0){
+            slab->top = slab_header + dsize;
+        }
+        else{
+            slab = new_life_chunk(lifetime);
+            if(slab == NULL){
+                return NULL;
+            }
+        }
+    }
+    char *bp = (char *) slab + slab->top;
+    *(word_t *) (bp - wsize) = asize;
+    slab->top += asize;
+    slab->used++;
+    return bp;
+}
+/*
+ * life_free: count object bp of lifetime chunk slab as dead.the last object bumped
+ * gives its bytes back at once,and a chunk whose objects are all dead is freed,unless
+ * it is still the current chunk of its class,which starts over instead.
+ */
+static void life_free(slab_t* slab, void *bp)
+{
+    slab->used--;
+    if(slab->used > 0){
+        size_t offset = (char *) bp - (char *) slab;
+        if(offset + *((word_t *) bp - 1) == slab->top){
+            slab->top = offset;
+        }
+        return;
+    }
+    if(life_current[slab->lifetime] == slab){
+        slab->top = slab_header + dsize;
+    }
+    else{
+        life_release(slab);
+    }
+}
+/*
+ * new_life_chunk: make a slab aligned lifetime chunk the current chunk of lifetime.
+ * the chunk it replaces is freed if none of its objects is alive.
+ * return value:NULL if heap cannot be extended or the chunk is out of reach of
+ * slab_pages.
+ */
+static slab_t *new_life_chunk(size_t lifetime)
+{
+    block_t *block = alloc_aligned_block(slab_size, slab_size);
+    if(block == NULL){
+        return NULL;
+    }
+    slab_t *slab = (slab_t *) header_to_payload(block);
+    size_t page = slab_page(slab);
+    if(page >= SLAB_PAGE_WORDS * 64){
+        free_block(block);
+        return NULL;
+    }
+    slab_pages[page / 64] |= (word_t)1 << (page % 64);
+    slab->next = NULL;
+    slab->prev = NULL;
+    slab->slot_size = 0;
+    slab->used = 0;
+    //payloads are dsize aligned like those of blocks,with their size word before them
+    slab->top = slab_header + dsize;
+    slab->lifetime = lifetime;
+    slab_count++;
+    life_count++;
+    slab_t *old = life_current[lifetime];
+    life_current[lifetime] = slab;
+    if(old != NULL && old->used == 0){
+        life_release(old);
+    }
+    return slab;
+}
+/*
+ * life_release: free the block of a lifetime chunk with no live object
+ */
+static void life_release(slab_t* slab)
+{
+    size_t page = slab_page(slab);
+    slab_pages[page / 64] &= ~((word_t)1 << (page % 64));
+    slab_count--;
+    life_count--;
+    free_block(payload_to_header(slab));
+}
+/*
+ * slot_usable: num of bytes that can be used at bp,which is in slab
+ */
+static size_t slot_usable(slab_t* slab, void *bp)
+{
+    if(slab->slot_size != 0){
+        return slab->slot_size;
+    }
+    return *((word_t *) bp - 1) - wsize;
+}
+#if !TLSF
+/*
+ * this function will search free lists and find the first block whose size is larger than
+ * what we need.the return value is a pointer points to this block
+ * <Are there any preconditions or postconditions?>
+ */
+static block_t *find_fit(size_t asize)
+{
+    int index = find_free_list(asize);
+    if(index == NUM-1){
+        block_t* temp = find_dsize_fit(asize);
+        if(temp != NULL){
+            return temp;
+        }
+    }
+    else if(index == 0){
+        return tree_fit(asize);
+    }
+    else{
+        //only the first list may hold blocks smaller than asize
+        block_t *block = best_in_list(leaf[index], asize);
+        if(block != NULL){
+            return block;
+        }
+    }
+    //every block in a non-empty list with a smaller index is large enough,
+    //so the closest one is the highest set bit below index
+    word_t mask = list_map & (((word_t)1 << index) - 1);
+    if(mask == 0){
+        return NULL;
+    }
+    index = (int) (8 * sizeof(word_t) - 1) - __builtin_clzll(mask);
+    if(index == 0){
+        return tree_fit(asize);
+    }
+    return best_in_list(leaf[index], asize);
+}
+/*
+ * best_in_list: walk from block towards the root of its list and examine at most
+ * BEST_FIT_K blocks that can hold asize.the return value is the smallest of them,
+ * or NULL if no block fits.an exact fit ends the search at once.
+ */
+static block_t *best_in_list(block_t* block, size_t asize){
+    block_t* best = NULL;
+    size_t best_size = 0;
+    int found = 0;
+    while(block != NULL && found < BEST_FIT_K){
+        size_t size = get_size(block);
+        if(size >= asize){
+            if(best == NULL || size < best_size){
+                best = block;
+                best_size = size;
             }
-            if(get_size(block_next_next) != dsize){
-                word_t* footerp_next_next = header_to_footer(block_next_next);
-                *footerp_next_next = block_next_next->header;
+            if(size == asize){
+                break;
             }
+            found++;
         }
+        block = block->u.st.prev;
     }
-    
-    dbg_ensures(get_alloc(block));
+    return best;
 }
 /*
- * this function will search free lists and find the first block whose size is larger than
- * what we need.the return value is a pointer points to this block
- * <Are there any preconditions or postconditions?>
+ * tree_fit: returns the smallest free block of list 0 that can hold asize, the one
+ * with the lowest address among equal sizes, or NULL if no block is large enough.
+ */
+static block_t *tree_fit(size_t asize){
+    block_t* best = NULL;
+    block_t* node = tree_root;
+    while(node != NULL){
+        if(get_size(node) >= asize){
+            best = node;
+            node = node->u.tr.left;
+        }
+        else{
+            node = node->u.tr.right;
+        }
+    }
+    return best;
+}
+#else
+/*
+ * find_fit(TLSF): rounds asize up to the next second level boundary so that every
+ * block in the chosen list fits, then finds the first non-empty list with two bit
+ * scans.the return value is a pointer points to this block, NULL if there is none.
  */
 static block_t *find_fit(size_t asize)
 {
-    int index = find_free_list(asize);
-    while(index >= 0){
-        if(index == NUM-1){
-            block_t* temp =  find_dsize_fit(asize);
-            if(temp == NULL){
-                index -= 1;
-                continue;
-            }
-            else{
-                return temp;
-            }
+    if(asize == dsize){
+        block_t* temp = find_dsize_fit(asize);
+        if(temp != NULL){
+            return temp;
         }
-        block_t *block = leaf[index];
-        while(block != NULL){
-            if(!get_alloc(block) && get_size(block) >= asize){
-                return block;
-            }
-            block = block->u.st.prev;
+    }
+    if(asize >= tlsf_small){
+        int log = (int) (8 * sizeof(word_t) - 1) - __builtin_clzll(asize);
+        asize += ((size_t) 1 << (log - tlsf_sl_log)) - 1;
+    }
+    int fl, sl;
+    tlsf_mapping(asize, &fl, &sl);
+    if(fl >= (int) tlsf_fl_num){
+        return NULL;
+    }
+    word_t sl_map = tlsf_sl_map[fl] & (~(word_t)0 << sl);
+    if(sl_map == 0){
+        word_t fl_map = tlsf_fl_map & (~(word_t)1 << fl);
+        if(fl_map == 0){
+            return NULL;
         }
-        index -= 1;
+        fl = __builtin_ctzll(fl_map);
+        sl_map = tlsf_sl_map[fl];
     }
-    return NULL;
+    sl = __builtin_ctzll(sl_map);
+    return tlsf_lists[fl][sl];
 }
+#endif
 static block_t *find_dsize_fit(size_t asize){
     if(root[NUM-1] == NULL){
-        return NULL;
+        return far_dsize_root;
     }
     else{
         return root[NUM-1];
@@ -640,10 +2473,33 @@ bool mm_checkheap(int line)
         block = find_next(block);
     }
     check_free_lists();
+    check_fast_bins();
+    check_slabs();
+    check_fresh();
     return true;
     
 }
 /*
+* check_fresh:check that the fresh part of heap is zero except for the header,links and
+* footer of the free last block and the epilogue
+*/
+bool check_fresh(){
+    word_t* epi = (word_t*) (mem_heap_hi()-wsize + 1);
+    block_t* top = find_top();
+    word_t* word = (word_t*) heap_fresh;
+    for(; word < epi; word++){
+        if(top != NULL && (word == &(top->header) || word == (word_t*) &(top->u.st.next) ||
+                           word == (word_t*) &(top->u.st.prev) || word == epi - 1)){
+            continue;
+        }
+        if(*word != 0){
+            dbg_printf("fresh heap is not zero!!!");
+            return false;
+        }
+    }
+    return true;
+}
+/*
 * check_consistency:check whether adjacent blocks such as adjacent free blocks and bits indications are wrong
 */
 bool check_consistency(block_t* block){
@@ -754,6 +2610,13 @@ static size_t max(size_t x, size_t y)
 {
     return (x > y) ? x : y;
 }
+/*
+ * min: returns x if x < y, and y otherwise.
+ */
+static size_t min(size_t x, size_t y)
+{
+    return (x < y) ? x : y;
+}
 /*
  * extract_size: returns the size of a given header value based on the header
  *               specification above.
@@ -852,6 +2715,7 @@ static word_t *header_to_footer(block_t *block)
 {
     return (word_t *) (block->u.payload + get_size(block) - dsize);
 }
+#if !TLSF
 /*
  *this function will add a new free block to the free list ,we always add it as 
  * the new root.the return value is true if we add this free block successfully,
@@ -868,11 +2732,17 @@ static bool add_new_free_block(block_t* block){
         add_dsize_free_block(block);
         return true;
     }
+    if(index == 0){
+        tree_root = tree_insert(tree_root, block);
+        list_map |= 0x1;
+        return true;
+    }
     if(root[index] == NULL){
         root[index] = block;
         leaf[index] = block;
         block->u.st.next = NULL;
         block->u.st.prev = NULL;
+        list_map |= (word_t)1 << index;
     }
     else{
         block_t* temp = root[index];
@@ -883,23 +2753,60 @@ static bool add_new_free_block(block_t* block){
     }
     return true;
 }
+#else
+/*
+ * add_new_free_block(TLSF): push block onto the head of its second level list and
+ * mark the list as non-empty in both bitmaps.
+ */
+static bool add_new_free_block(block_t* block){
+    if(block == NULL){
+        return false;
+    }
+    size_t size = get_size(block);
+    if(size == dsize){
+        add_dsize_free_block(block);
+        return true;
+    }
+    int fl, sl;
+    tlsf_mapping(size, &fl, &sl);
+    block_t* temp = tlsf_lists[fl][sl];
+    block->u.st.next = temp;
+    block->u.st.prev = NULL;
+    if(temp != NULL){
+        temp->u.st.prev = block;
+    }
+    tlsf_lists[fl][sl] = block;
+    tlsf_fl_map |= (word_t)1 << fl;
+    tlsf_sl_map[fl] |= (word_t)1 << sl;
+    return true;
+}
+#endif
 /*
 * add_dsize_free_block: given block ,add it as first block of free list.This function 
-* will only be called when block is 16 bytes.In this case,free list is single list.
+* will only be called when block is 16 bytes.In this case,free list is linked by two
+* 32-bit offsets so that any block can be unlinked in constant time.Blocks whose offset
+* does not fit in 32 bits go to a singly linked list instead.
 */
 static bool add_dsize_free_block(block_t* block){
     int index = NUM - 1;
+    list_map |= (word_t)1 << index;
+    if(!mini_linkable(block)){
+        block->u.st.next = far_dsize_root;
+        far_dsize_root = block;
+        return true;
+    }
+    block->u.mini.prev = 0;
     if(root[index] == NULL){
-        root[index] = block;
-        leaf[index] = block;
-        block->u.st.next = NULL;
+        block->u.mini.next = 0;
     }
     else{
-        block->u.st.next = root[index];
-        root[index] = block;
+        block->u.mini.next = mini_encode(root[index]);
+        root[index]->u.mini.prev = mini_encode(block);
     }
+    root[index] = block;
     return true;
 }
+#if !TLSF
 /*
  *this function will delete a free block if this free block get picked and set as allocated
  *the return value is true if we delete this free block successfully,otherwise false;
@@ -911,6 +2818,13 @@ static bool delete_block_from_list(block_t* block){
         delete_dsize_free_block(block);
         return true;
     }
+    if(index == 0){
+        tree_root = tree_remove(tree_root, block);
+        if(tree_root == NULL){
+            list_map &= ~(word_t)0x1;
+        }
+        return true;
+    }
     if((block == NULL) || (root[index] == NULL)){
         return false;
     }
@@ -920,6 +2834,7 @@ static bool delete_block_from_list(block_t* block){
         //it is root
         root[index] = NULL;
         leaf[index] = NULL;
+        list_map &= ~((word_t)1 << index);
     }
     else if((next != NULL) && (prev == NULL)){
         root[index] = next;
@@ -935,38 +2850,106 @@ static bool delete_block_from_list(block_t* block){
     }
     return true;
 }
+#else
+/*
+ * delete_block_from_list(TLSF): unlink block from its second level list and clear
+ * the bitmaps when the list becomes empty.
+ */
+static bool delete_block_from_list(block_t* block){
+    if(block == NULL){
+        return false;
+    }
+    size_t size = get_size(block);
+    if(size == dsize){
+        delete_dsize_free_block(block);
+        return true;
+    }
+    int fl, sl;
+    tlsf_mapping(size, &fl, &sl);
+    block_t* next = block->u.st.next;
+    block_t* prev = block->u.st.prev;
+    if(prev == NULL){
+        tlsf_lists[fl][sl] = next;
+    }
+    else{
+        prev->u.st.next = next;
+    }
+    if(next != NULL){
+        next->u.st.prev = prev;
+    }
+    if(tlsf_lists[fl][sl] == NULL){
+        tlsf_sl_map[fl] &= ~((word_t)1 << sl);
+        if(tlsf_sl_map[fl] == 0){
+            tlsf_fl_map &= ~((word_t)1 << fl);
+        }
+    }
+    return true;
+}
+#endif
 /*
 * delete_dsize_free_block: given block ,delete it from free list.This function will only
-* be called when block is 16 bytes.In this case,free list is single list
+* be called when block is 16 bytes.Only blocks far from heap_start have to search the
+* singly linked list.
 */
 static bool delete_dsize_free_block(block_t* block){
-    if(block == root[NUM-1]){
-        if(root[NUM-1] == leaf[NUM-1]){
-            root[NUM-1] = NULL;
-            leaf[NUM-1] = NULL;
+    int index = NUM - 1;
+    if(mini_linkable(block)){
+        block_t* next = mini_decode(block->u.mini.next);
+        block_t* prev = mini_decode(block->u.mini.prev);
+        if(prev == NULL){
+            root[index] = next;
         }
         else{
-            root[NUM-1] = root[NUM-1]->u.st.next;
+            prev->u.mini.next = block->u.mini.next;
         }
+        if(next != NULL){
+            next->u.mini.prev = block->u.mini.prev;
+        }
+    }
+    else if(block == far_dsize_root){
+        far_dsize_root = block->u.st.next;
     }
     else{
-        block_t* temp = root[NUM-1];
-        block_t* tmp = temp->u.st.next;
-        while(tmp != NULL){
-            if(tmp==block){
-                block_t* blk = tmp->u.st.next;
-                temp->u.st.next = blk;
-                if(blk == NULL){
-                    leaf[NUM-1] = temp;
-                }
-                return true;
-            }
-            temp = tmp;
-            tmp = tmp->u.st.next;
+        block_t* temp = far_dsize_root;
+        while(temp != NULL && temp->u.st.next != block){
+            temp = temp->u.st.next;
+        }
+        if(temp == NULL){
+            return false;
         }
+        temp->u.st.next = block->u.st.next;
+    }
+    if(root[index] == NULL && far_dsize_root == NULL){
+        list_map &= ~((word_t)1 << index);
     }
     return true;
 }
+/*
+ * mini_linkable: returns true if block is close enough to heap_start for its offset
+ *                to be stored as a 32-bit link
+ */
+static bool mini_linkable(block_t* block){
+    size_t offset = (size_t) ((char *) block - (char *) heap_start) / dsize;
+    return offset < mini_link_max;
+}
+/*
+ * mini_encode: returns the 32-bit link of a block, 0 for NULL
+ */
+static uint32_t mini_encode(block_t* block){
+    if(block == NULL){
+        return 0;
+    }
+    return (uint32_t) ((size_t) ((char *) block - (char *) heap_start) / dsize + 1);
+}
+/*
+ * mini_decode: returns the block a 32-bit link refers to, NULL for 0
+ */
+static block_t *mini_decode(uint32_t link){
+    if(link == 0){
+        return NULL;
+    }
+    return (block_t *) ((char *) heap_start + (size_t) (link - 1) * dsize);
+}
 /*
  * my_round_up: if size is less than wsize then return dsize,otherwise due to existence of 
  * two pointers,the least size of one block is 32 bytes
@@ -1026,78 +3009,96 @@ static void my_write_footer(block_t *block, size_t size, bool prev_dsize_or_not,
 }
 /*
  *find_free_list:find corresponding free list according to block size
+ *               16, 32 and 48 bytes blocks have their own lists(11, 10, 9),
+ *               larger blocks are grouped by power of two, from [64,128)
+ *               in list 8 down to [chunksize, inf) in list 0.the class is
+ *               computed with one bit scan instead of comparing size against
+ *               every boundary.
  *arguments:size of block
  *return value:offset of corresponding free list
 */
 static int find_free_list(size_t size){
-    if(size >= chunksize){
-        return 0;
-    }
-    else if(size >= (chunksize>>1)){
-        return 1;
-    }
-    else if(size >= (chunksize>>2)){
-        return 2;
-    }
-    else if(size >= (chunksize>>3)){
-        return 3;
-    }
-    else if(size >= (chunksize>>4)){
-        return 4;
-    }
-    else if(size >= (chunksize>>5)){
-        return 5;
-    }
-    else if(size >= (chunksize>>6)){
-        return 6;
-    }
-    else if(size == (chunksize>>7)){
-        return 7;
-    }
-    else if(size >= (chunksize>>8)){
-        return 8;
-    }
-    else if(size == (chunksize>>8)-dsize){
-        return 9;
-    }
-    else if(size == (chunksize>>8)-2*dsize){
-        return 10;
-    }
-    else if(size == (chunksize>>8)-3*dsize){
-        return 11;
-    }
-    else{
-        return -1;
+    if(size < (chunksize>>8)){
+        return (int) (NUM - size/dsize);
     }
+    int log = (int) (8 * sizeof(word_t) - 1) - __builtin_clzll(size);
+    //list 0 starts at chunksize = 1 << 14
+    int index = 14 - log;
+    return index > 0 ? index : 0;
 }
 /*
  *initialize_list:initialize free lists.
  *arguments:root:an array of pointers which are first blocks of free lists
  *          leaf:an array of pointers which are last blocks of free lists
- *          block:return value of function extend_heap
  * return value:none
 */
-static void initialize_list(block_t** root, block_t** leaf, block_t* block){
-    root[0] = block;
-    leaf[0] = block;
+static void initialize_list(block_t** root, block_t** leaf){
+    list_map = 0;
+    far_dsize_root = NULL;
+    tree_root = NULL;
+    fast_map = 0;
+    slab_count = 0;
+    life_count = 0;
+    grow_size = chunksize;
+    fit_count = 0;
+    grow_stamp = 0;
     size_t index;
-    for(index = 1;index < NUM; index++){
+    for(index = 0; index < FAST_NUM; index++){
+        fast_bins[index] = NULL;
+    }
+    for(index = 0; index < LIFETIMES; index++){
+        life_current[index] = NULL;
+    }
+    for(index = 0; index < SLAB_NUM; index++){
+        slab_partial[index] = NULL;
+        slab_full[index] = NULL;
+    }
+    for(index = 0; index < SLAB_PAGE_WORDS; index++){
+        slab_pages[index] = 0;
+    }
+    for(index = 0;index < NUM; index++){
         root[index] = NULL;
         leaf[index] = NULL;
     }
+#if TLSF
+    tlsf_fl_map = 0;
+    for(index = 0;index < tlsf_fl_num; index++){
+        tlsf_sl_map[index] = 0;
+        size_t sl;
+        for(sl = 0;sl < tlsf_sl_num; sl++){
+            tlsf_lists[index][sl] = NULL;
+        }
+    }
+#endif
     return;
 }
+#if !TLSF
 /*
  *check_free_lists:check free blocks in free lists
  *arguments:root:start block
  * return value:if every block in free lists satisfy requirements ,return true ,false otherwise.
 */
 bool check_free_lists(){
-    size_t index = NUM - 1;
+    int index = NUM - 1;
     while(index >= 0){
+        bool mapped = (list_map >> index) & 0x1;
+        bool empty = (root[index] == NULL);
+        if(index == NUM - 1){
+            empty = empty && (far_dsize_root == NULL);
+        }
+        if(index == 0){
+            empty = (tree_root == NULL);
+        }
+        if(mapped == empty){
+            dbg_printf("list map does not match free list %d!!!", index);
+            return false;
+        }
         if(index == NUM - 1){
             check_dsize_free_lists();
         }
+        else if(index == 0){
+            check_tree(tree_root, NULL, NULL);
+        }
         else{
             block_t* begin = root[index];
             while(begin != NULL){
@@ -1121,7 +3122,173 @@ bool check_free_lists(){
     return true;
 }
 /*
- *check_dsize_free_lists:check singly free list
+ *check_tree:check that every node of the large block treap is a free block of list 0,
+ *           that nodes are ordered by size and address, and that priorities form a heap
+ *arguments:tree:subtree to check,lo and hi:bounds of its keys,NULL if unbounded
+*/
+static bool check_tree(block_t* tree, block_t* lo, block_t* hi){
+    if(tree == NULL){
+        return true;
+    }
+    if(get_alloc(tree) || find_free_list(get_size(tree)) != 0){
+        dbg_printf("there is wrong block in large block tree!!!");
+        return false;
+    }
+    if((lo != NULL && !tree_less(lo, tree)) || (hi != NULL && !tree_less(tree, hi))){
+        dbg_printf("large block tree is not ordered!!!");
+        return false;
+    }
+    block_t* left = tree->u.tr.left;
+    block_t* right = tree->u.tr.right;
+    if((left != NULL && tree_priority(left) > tree_priority(tree)) ||
+       (right != NULL && tree_priority(right) > tree_priority(tree))){
+        dbg_printf("large block tree is not a heap!!!");
+        return false;
+    }
+    return check_tree(left, lo, tree) && check_tree(right, tree, hi);
+}
+/*
+ *tree_less:order of nodes in the large block treap,by size and then by address
+*/
+static bool tree_less(block_t* a, block_t* b){
+    size_t size_a = get_size(a);
+    size_t size_b = get_size(b);
+    return size_a < size_b || (size_a == size_b && a < b);
+}
+/*
+ *tree_priority:heap priority of a treap node,a hash of its address so that no field
+ *              is needed to store it
+*/
+static word_t tree_priority(block_t* block){
+    word_t x = (word_t) (size_t) block;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+}
+/*
+ *tree_split:split tree into nodes ordered before key and nodes ordered after it
+*/
+static void tree_split(block_t* tree, block_t* key, block_t** left, block_t** right){
+    if(tree == NULL){
+        *left = NULL;
+        *right = NULL;
+    }
+    else if(tree_less(tree, key)){
+        *left = tree;
+        tree_split(tree->u.tr.right, key, &(tree->u.tr.right), right);
+    }
+    else{
+        *right = tree;
+        tree_split(tree->u.tr.left, key, left, &(tree->u.tr.left));
+    }
+}
+/*
+ *tree_merge:join two treaps,every node of left is ordered before every node of right
+*/
+static block_t *tree_merge(block_t* left, block_t* right){
+    if(left == NULL){
+        return right;
+    }
+    if(right == NULL){
+        return left;
+    }
+    if(tree_priority(left) > tree_priority(right)){
+        left->u.tr.right = tree_merge(left->u.tr.right, right);
+        return left;
+    }
+    right->u.tr.left = tree_merge(left, right->u.tr.left);
+    return right;
+}
+/*
+ *tree_insert:insert block into tree,return value is the new root
+*/
+static block_t *tree_insert(block_t* tree, block_t* block){
+    if(tree == NULL || tree_priority(block) > tree_priority(tree)){
+        tree_split(tree, block, &(block->u.tr.left), &(block->u.tr.right));
+        return block;
+    }
+    if(tree_less(block, tree)){
+        tree->u.tr.left = tree_insert(tree->u.tr.left, block);
+    }
+    else{
+        tree->u.tr.right = tree_insert(tree->u.tr.right, block);
+    }
+    return tree;
+}
+/*
+ *tree_remove:remove block from tree,return value is the new root
+*/
+static block_t *tree_remove(block_t* tree, block_t* block){
+    if(tree == NULL){
+        return NULL;
+    }
+    if(tree == block){
+        return tree_merge(block->u.tr.left, block->u.tr.right);
+    }
+    if(tree_less(block, tree)){
+        tree->u.tr.left = tree_remove(tree->u.tr.left, block);
+    }
+    else{
+        tree->u.tr.right = tree_remove(tree->u.tr.right, block);
+    }
+    return tree;
+}
+#else
+/*
+ *check_free_lists(TLSF):check every second level list and both bitmaps
+ * return value:if every block in free lists satisfy requirements ,return true ,false otherwise.
+*/
+bool check_free_lists(){
+    size_t fl, sl;
+    for(fl = 0;fl < tlsf_fl_num; fl++){
+        bool fl_mapped = (tlsf_fl_map >> fl) & 0x1;
+        if(fl_mapped != (tlsf_sl_map[fl] != 0)){
+            dbg_printf("first level map does not match second level map!!!");
+            return false;
+        }
+        for(sl = 0;sl < tlsf_sl_num; sl++){
+            block_t* begin = tlsf_lists[fl][sl];
+            bool mapped = (tlsf_sl_map[fl] >> sl) & 0x1;
+            if(mapped != (begin != NULL)){
+                dbg_printf("second level map does not match free list!!!");
+                return false;
+            }
+            while(begin != NULL){
+                int f, s;
+                tlsf_mapping(get_size(begin), &f, &s);
+                if(get_alloc(begin) || f != (int) fl || s != (int) sl){
+                    dbg_printf("there is wrong block in tlsf free list!!!");
+                    return false;
+                }
+                block_t* next = begin->u.st.next;
+                if(next != NULL && next->u.st.prev != begin){
+                    dbg_printf("link list is not right!!!");
+                    return false;
+                }
+                begin = next;
+            }
+        }
+    }
+    return check_dsize_free_lists();
+}
+/*
+ *tlsf_mapping:find first and second level list of a block size
+ *arguments:size of block,fl and sl are set to the list offsets
+*/
+static void tlsf_mapping(size_t size, int* fl, int* sl){
+    if(size < tlsf_small){
+        *fl = 0;
+        *sl = (int) (size / dsize);
+        return;
+    }
+    int log = (int) (8 * sizeof(word_t) - 1) - __builtin_clzll(size);
+    *fl = log - tlsf_small_log + 1;
+    *sl = (int) ((size >> (log - tlsf_sl_log)) - tlsf_sl_num);
+}
+#endif
+/*
+ *check_dsize_free_lists:check free list of 16 bytes blocks
 */
 bool check_dsize_free_lists(){
     size_t index = NUM - 1;
@@ -1136,14 +3303,116 @@ bool check_dsize_free_lists(){
             dbg_printf("there is allocated block in dsize free list!!!");
             return false;
         }
-        if(start != root[index]){
-            bool dsize_or_not = (start->header) & dsize_mask;
-            if(!dsize_or_not){
-                dbg_printf("dsize bit is wrong!!!");
+        block_t* next = mini_decode(start->u.mini.next);
+        if(next != NULL && mini_decode(next->u.mini.prev) != start){
+            dbg_printf("dsize link list is not right!!!");
+            return false;
+        }
+        start = next;
+    }
+    start = far_dsize_root;
+    while(start != NULL){
+        if(get_size(start) != dsize || get_alloc(start)){
+            dbg_printf("there is something weird in far dsize free list!!!");
+            return false;
+        }
+        start = start->u.st.next;
+    }
+    return true;
+}
+/*
+ *check_fast_bins:check that blocks in fast bins are still marked allocated,have the
+ *                size of their bin and that the fast bin map is right
+*/
+bool check_fast_bins(){
+    size_t index;
+    for(index = 0; index < FAST_NUM; index++){
+        bool mapped = (fast_map >> index) & 0x1;
+        if(mapped == (fast_bins[index] == NULL)){
+            dbg_printf("fast map does not match fast bin %zu!!!", index);
+            return false;
+        }
+        block_t* block = fast_bins[index];
+        while(block != NULL){
+            if(!get_alloc(block) || get_size(block) != (index + 1) * dsize){
+                dbg_printf("there is wrong block in fast bin %zu!!!", index);
                 return false;
             }
+            block = block->u.st.next;
         }
-        start = start->u.st.next;
+    }
+    return true;
+}
+/*
+ *check_slabs:check that every slab is an aligned allocated block,that its slot count
+ *            matches its bitmap and that it is in the right list of its class,and
+ *            that the current lifetime chunks are marked slab pages of their class
+*/
+bool check_slabs(){
+    size_t index;
+    size_t count = 0;
+    for(index = 0; index < SLAB_NUM; index++){
+        int full;
+        for(full = 0; full < 2; full++){
+            slab_t* slab = full ? slab_full[index] : slab_partial[index];
+            slab_t* prev = NULL;
+            while(slab != NULL){
+                block_t* block = payload_to_header(slab);
+                if(((size_t) slab & (slab_size - 1)) != 0 || !get_alloc(block)
+                   || get_size(block) != slab_size){
+                    dbg_printf("slab is not an aligned allocated block!!!");
+                    return false;
+                }
+                if(slab->slot_size != (index + 1) * dsize || slab->prev != prev){
+                    dbg_printf("slab is in wrong slab list!!!");
+                    return false;
+                }
+                size_t used = 0;
+                size_t word;
+                for(word = 0; word < SLAB_MAP_WORDS; word++){
+                    used += __builtin_popcountll(slab->used_map[word]);
+                }
+                size_t capacity = slab_capacity(slab);
+                size_t page = slab_page(slab);
+                if(!(slab_pages[page / 64] & ((word_t)1 << (page % 64)))){
+                    dbg_printf("slab page is not marked!!!");
+                    return false;
+                }
+                if(slab->capacity != capacity){
+                    dbg_printf("slab capacity is wrong!!!");
+                    return false;
+                }
+                if(used - (SLAB_MAP_WORDS * 64 - capacity) != slab->used
+                   || full != (slab->used == capacity)){
+                    dbg_printf("slab used count is wrong!!!");
+                    return false;
+                }
+                count++;
+                prev = slab;
+                slab = slab->next;
+            }
+        }
+    }
+    size_t pages = 0;
+    for(index = 0; index < SLAB_PAGE_WORDS; index++){
+        pages += __builtin_popcountll(slab_pages[index]);
+    }
+    for(index = 1; index < LIFETIMES; index++){
+        slab_t* slab = life_current[index];
+        if(slab == NULL){
+            continue;
+        }
+        size_t page = slab_page(slab);
+        if(((size_t) slab & (slab_size - 1)) != 0 || slab->slot_size != 0
+           || slab->lifetime != index || slab->top > slab_size
+           || !(slab_pages[page / 64] & ((word_t)1 << (page % 64)))){
+            dbg_printf("lifetime chunk is wrong!!!");
+            return false;
+        }
+    }
+    if(count + life_count != slab_count || pages != slab_count){
+        dbg_printf("slab count is wrong!!!");
+        return false;
     }
     return true;
 }
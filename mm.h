@@ -6,20 +6,56 @@
 /* declare functions for driver tests */
 extern void *mm_malloc (size_t size);
 extern void mm_free (void *ptr);
+extern void mm_free_sized(void *ptr, size_t size);
+extern size_t mm_malloc_batch(size_t size, size_t n, void **out);
+extern void mm_free_batch(void **ptrs, size_t n);
+extern void *mm_malloc_hint(size_t size, int lifetime);
 extern void *mm_realloc(void *ptr, size_t size);
 extern void *mm_calloc (size_t nmemb, size_t size);
+extern void *mm_memalign(size_t alignment, size_t size);
+extern void *mm_aligned_alloc(size_t alignment, size_t size);
+extern int mm_posix_memalign(void **memptr, size_t alignment, size_t size);
+extern size_t mm_usable_size(void *ptr);
 
 #else
 
 /* declare functions for interpositioning */
 extern void *malloc (size_t size);
 extern void free (void *ptr);
+extern void free_sized(void *ptr, size_t size);
+extern size_t malloc_batch(size_t size, size_t n, void **out);
+extern void free_batch(void **ptrs, size_t n);
+extern void *malloc_hint(size_t size, int lifetime);
 extern void *realloc(void *ptr, size_t size);
 extern void *calloc (size_t nmemb, size_t size);
+extern void *memalign(size_t alignment, size_t size);
+extern void *aligned_alloc(size_t alignment, size_t size);
+extern int posix_memalign(void **memptr, size_t alignment, size_t size);
+extern size_t malloc_usable_size(void *ptr);
 
 #endif
 
 extern bool mm_init(void);
 
+/*
+ * Lifetime classes for malloc_hint: objects expected to die soon get low
+ * classes, long-lived ones high classes, and 0 means no hint at all.
+ */
+#define MM_LIFETIMES 4
+
+/*
+ * Arenas bump allocate objects from chunks of the heap. Their objects are
+ * never freed one by one: mm_arena_reset frees all of them at once, and
+ * mm_arena_destroy frees the arena as well.
+ */
+typedef struct mm_arena mm_arena_t;
+extern mm_arena_t *mm_arena_create(void);
+extern void *mm_arena_alloc(mm_arena_t *arena, size_t size);
+extern void mm_arena_reset(mm_arena_t *arena);
+extern void mm_arena_destroy(mm_arena_t *arena);
+
+/* Return the free top of the heap to the system, keeping pad bytes */
+extern bool mm_trim(size_t pad);
+
 /* This is for debugging.  Returns false if error encountered */
 extern bool mm_checkheap(int lineno);